@@ -1,6 +1,7 @@
 //#define C_BUILD_IMPLEMENTATION
 #include"build.h"
 #include<stdio.h>
+#include<stdlib.h>
 #include<string.h>
 
 
@@ -36,13 +37,43 @@ const CbsModule module_main = (CbsModule){
     .output_file_name_with_extension = "main.exe",
 };
 
+//picked with --config=<name>, the first one is built without it
+const CbsConfiguration configurations[] = {
+    {.name = "debug",   .compiler_flags = {.items = (const char*[]){"-O0","-g"},.length = 2}},
+    {.name = "release", .compiler_flags = {.items = (const char*[]){"-O2","-DNDEBUG"},.length = 2}},
+};
+
 
 // ==================================================
 // =============== COMMANDS DEFINITION ==============
 // ==================================================
 
 void Command_Build_All(const int argc, const char** argv){
-    cbs_module_compile(module_main);
+    cbs_parse_options(argc, argv);
+    if(cbs_modules_build(&module_main, 1) == false) exit(1);
+}
+
+void Command_Test(const int argc, const char** argv){
+    cbs_parse_options(argc, argv);
+    if(cbs_modules_test(&module_main, 1) == false) exit(1);
+}
+
+void Command_Bench_Run(const int argc, const char** argv){
+    cbs_parse_options(argc, argv);
+    if(cbs_modules_bench(&module_main, 1) == false) exit(1);
+}
+
+void Command_Install(const int argc, const char** argv){
+    cbs_parse_options(argc, argv);
+    if(cbs_modules_install(&module_main, 1) == false) exit(1);
+}
+
+void Command_PGO(const int argc, const char** argv){
+    if(cbs_modules_pgo(&module_main, 1, argc, argv) == false) exit(1);
+}
+
+void Command_Export_Ninja(const int argc, const char** argv){
+    if(cbs_modules_export_ninja(&module_main, 1, argc, argv) == false) exit(1);
 }
 
 void Command_CC(const int argc, const char** argv){
@@ -55,6 +86,31 @@ const CbsCommand all_commands[] = {
     .description = "builds all the modules",
     .fnptr = Command_Build_All
     },
+    (CbsCommand){
+        .name = "test",
+        .description = "builds the modules and runs the ones marked is_test",
+        .fnptr = Command_Test
+    },
+    (CbsCommand){
+        .name = "bench-run",
+        .description = "builds the modules and runs the ones marked is_benchmark against the baseline",
+        .fnptr = Command_Bench_Run
+    },
+    (CbsCommand){
+        .name = "install",
+        .description = "builds the modules and copies their outputs into the prefix. install --prefix=<dir>",
+        .fnptr = Command_Install
+    },
+    (CbsCommand){
+        .name = "pgo",
+        .description = "profile guided build. pgo <module> -- <training command>",
+        .fnptr = Command_PGO
+    },
+    (CbsCommand){
+        .name = "export-ninja",
+        .description = "writes a build.ninja for the modules",
+        .fnptr = Command_Export_Ninja
+    },
     (CbsCommand){
         .name = "cc",
         .description = "create the compiler_commands.json",
@@ -80,6 +136,7 @@ int main(const int argc, const char **argv){
     }
 
     const char* command_input = argv[1]; 
+    cbs_set_configurations(configurations, sizeof(configurations)/sizeof(CbsConfiguration));
 
     for (int i = 0; i < command_count; i++) {
         CbsCommand command = all_commands[i];
@@ -4,6 +4,7 @@
 
 #include <stddef.h>
 #include<stdint.h>
+#include<stdbool.h>
 
 //==================================
 //======== PUBLIC API ==============
@@ -13,6 +14,48 @@ typedef struct CbsStringArray{
     const int length;
 }CbsStringArray;
 
+typedef enum CbsLto{
+    CBS_LTO_OFF,
+    CBS_LTO_FULL,
+    CBS_LTO_THIN
+}CbsLto;
+
+//only used when the flags turn debug info on (-g), ignored for cl and on mac
+typedef struct CbsDebugInfo{
+    //debug info stays in a .dwo next to each object instead of being copied into the output
+    const bool split_dwarf;
+    //packs the .dwo files into <output>.dwp after the link with llvm-dwp
+    const bool package_dwp;
+    const bool compress;
+    //index for gdb built at link time, links with gold (gcc) or lld (clang) unless another linker was picked
+    const bool gdb_index;
+}CbsDebugInfo;
+
+//a command that writes files the compiles need, e.g. a protocol compiler or a code generator script.
+//it runs in the project folder before the compiles of every module that lists it, and only when
+//an input changed, an output is missing or the command changed
+typedef struct CbsStep{
+    const char *name;
+    const char *command;
+    //relative to the project folder
+    const CbsStringArray inputs;
+    const CbsStringArray outputs;
+    //make style depfile written by the command, the files in it count as inputs. NULL for none
+    const char *depfile;
+}CbsStep;
+
+typedef struct CbsStepArray{
+    const CbsStep *items;
+    const int length;
+}CbsStepArray;
+
+typedef enum CbsBenchmarkFormat{
+    //lines like "bench parse_small 1.25 ms" in the output, units are ns, us, ms and s
+    CBS_BENCHMARK_LINES,
+    //google benchmark, run with --benchmark_out and read from its json
+    CBS_BENCHMARK_GOOGLE
+}CbsBenchmarkFormat;
+
 typedef struct CbsModule{
     const char *name;
     const char *compiler;
@@ -29,8 +72,37 @@ typedef struct CbsModule{
     const CbsStringArray source_files_to_exclude;
     const char *output_file_name_with_extension;
     const char *output_directory;
+    const CbsStringArray module_dependencies;
+    const CbsStringArray source_patterns;
+    const CbsStringArray source_file_extensions;
+    const CbsLto lto;
+    const bool batch_compiles;
+    const bool is_test;
+    const int test_timeout_seconds;
+    const CbsDebugInfo debug_info;
+    //outputs don't depend on where the project is checked out or when it was built, see the README
+    const bool reproducible;
+    //outputs of the steps ending in one of the source_file_extensions are compiled with the module
+    const CbsStepArray steps;
+    const bool is_benchmark;
+    const CbsBenchmarkFormat benchmark_format;
+    //how much slower than the baseline a median may get before bench-run fails, 0 picks 5
+    const double benchmark_threshold_percent;
+    //folder inside the install prefix the output goes to, NULL puts libraries in "lib" and the rest in "bin"
+    const char *install_directory;
+    //relative to the project folder. headers go to "include" in the prefix, files go next to the output.
+    //a folder is installed with everything in it
+    const CbsStringArray install_headers;
+    const CbsStringArray install_files;
 } CbsModule;
 
+//a named set of flags layered over every module, e.g. debug, release or asan
+typedef struct CbsConfiguration{
+    const char *name;
+    const CbsStringArray compiler_flags;
+    const CbsStringArray linker_flags;
+}CbsConfiguration;
+
 typedef struct CbsCommand{
     const char *name , *description;
     void(*fnptr)(const int argc, const char** argv);
@@ -38,6 +110,35 @@ typedef struct CbsCommand{
 
 #define TO_CBS_STRING_ARRAY(string_array) (CbsStringArray){.items = string_array,.length = sizeof(string_array)/sizeof(char*)}
 void cbs_module_compile(CbsModule module);
+bool cbs_modules_build(const CbsModule *module_array,const int array_length);
+void cbs_parse_options(const int argc, const char **argv);
+void cbs_set_configurations(const CbsConfiguration *configuration_array,const int configuration_count);
+bool cbs_modules_pgo(const CbsModule *module_array,const int array_length,const int argc,const char **argv);
+bool cbs_modules_test(const CbsModule *module_array,const int array_length);
+bool cbs_modules_bench(const CbsModule *module_array,const int array_length);
+bool cbs_modules_install(const CbsModule *module_array,const int array_length);
+bool cbs_modules_export_ninja(const CbsModule *module_array,const int array_length,const int argc,const char **argv);
+
+typedef enum CbsProbeKind{
+    //compiles with the flag and warnings as errors
+    CBS_PROBE_FLAG,
+    //compiles an #include of the header
+    CBS_PROBE_HEADER,
+    //links a call to the function
+    CBS_PROBE_FUNCTION
+}CbsProbeKind;
+
+typedef struct CbsProbe{
+    CbsProbeKind kind;
+    const char *name;
+    //set by cbs_probe
+    bool found;
+}CbsProbe;
+
+bool cbs_probe(const char *compiler,CbsProbe *probe_array,const int array_length);
+bool cbs_compiler_supports_flag(const char *compiler,const char *flag);
+bool cbs_has_header(const char *compiler,const char *header);
+bool cbs_check_function(const char *compiler,const char *function);
 
 void cbs_command_run_matching(
     const int argc,
@@ -65,6 +166,7 @@ void create_compile_commands_json(const CbsModule *module_array,const int array_
 
 #include <stdbool.h>
 #include<stdio.h>
+#include<stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <ctype.h>
@@ -98,12 +200,13 @@ static bool string_is_null_empty_or_whitespace(const char* string){
         if(!isspace(c)){
             return false;
         }        
+        i++;
     }
     return true;
 }
 
 static bool string_starts_with(const char* string, const char* prefix){
-    int result = memcmp(string,prefix,strlen(prefix));
+    int result = strncmp(string,prefix,strlen(prefix));
     if(result == 0)return true;
     else return false;
 }
@@ -165,18 +268,6 @@ static void buffer_remove_characters_from_end(char* buffer,size_t character_coun
     }
 }
 
-static bool is_c_file(const char *filename){
-    size_t filename_length = strlen(filename);
-    if(filename_length <3) return false;
-
-    if(filename[filename_length-2] == '.'
-    && filename[filename_length-1] == 'c'){
-        return true;
-    }
-
-    return false;
-}
-
 #ifdef _WIN32
 #define FILE_PATH_MAX 260
 #define FILE_SEPARATOR '\\'
@@ -194,9 +285,42 @@ static bool is_c_file(const char *filename){
 #endif
 
 #define COMMAND_BUFFER_SIZE 65535
+#define CBS_STATE_DIRECTORY ".cbs"
+#define CBS_OBJECT_DIRECTORY "obj"
+#define CBS_RECORDS_FILENAME "records"
+#define CBS_CONFIGURATION_DIRECTORY "config"
+//given to the jobs of reproducible modules unless it's already set
+#define CBS_REPRODUCIBLE_ENVIRONMENT "SOURCE_DATE_EPOCH=0"
+
+//used to order jobs that have no recorded duration from a previous run
+#define CBS_ESTIMATE_BASE_MS 20
+#define CBS_ESTIMATE_SOURCE_BYTES_PER_MS 256
+#define CBS_ESTIMATE_LINK_MS_PER_OBJECT 2
+//thin lto cache of every module, pruned by the linker itself
+#define CBS_LTO_CACHE_DIRECTORY "lto"
+#define CBS_LTO_CACHE_PRUNE_AFTER_HOURS 168
+#define CBS_LTO_CACHE_PRUNE_INTERVAL_MINUTES 20
+#define CBS_LTO_CACHE_MAX_MEGABYTES 1024
+#define CBS_LTO_CACHE_MAX_PERCENT_OF_DISK 5
+//batched compiles stop growing at either limit
+#define CBS_BATCH_MAX_SOURCES 32
+#define CBS_BATCH_TARGET_MS 1000
+
+//snprintf into a FILE_PATH_MAX buffer, a path that doesn't fit is an error instead of a shorter path
+static bool path_format(char *path_buffer,const char *format,...){
+    va_list args;
+    va_start(args,format);
+    int length = vsnprintf(path_buffer,FILE_PATH_MAX,format,args);
+    va_end(args);
+    if(length < 0 || length >= FILE_PATH_MAX){
+        cbs_log_error("path longer than %d bytes [%.80s...]",FILE_PATH_MAX - 1,path_buffer);
+        return false;
+    }
+    return true;
+}
 
 static void remove_filename_from_path(char* path_buffer,uint32_t path_length){
-    for (uint32_t i = path_length-1; i >= 0; i--) {
+    for (int64_t i = (int64_t)path_length-1; i >= 0; i--) {
         char c = path_buffer[i];
         if(c == FILE_SEPARATOR){
             path_buffer[i+1] = '\0';
@@ -205,7 +329,391 @@ static void remove_filename_from_path(char* path_buffer,uint32_t path_length){
     }
 }
 
+// ==========================================
+// ============ CONTAINERS ==================
+// ==========================================
+
+typedef struct CbsStringBuilder{
+    char *items;
+    size_t length;
+    size_t capacity;
+}CbsStringBuilder;
+
+static void builder_reserve(CbsStringBuilder *builder,size_t extra){
+    if(builder->length + extra + 1 <= builder->capacity) return;
+    size_t capacity = builder->capacity == 0 ? 256 : builder->capacity;
+    while(builder->length + extra + 1 > capacity){
+        capacity *= 2;
+    }
+    builder->items = realloc(builder->items,capacity);
+    builder->capacity = capacity;
+}
+
+static void builder_append_string(CbsStringBuilder *builder,const char *string){
+    size_t string_length = strlen(string);
+    builder_reserve(builder,string_length);
+    memcpy(&builder->items[builder->length],string,string_length);
+    builder->length += string_length;
+    builder->items[builder->length] = '\0';
+}
+
+static void builder_append_char(CbsStringBuilder *builder,const char character){
+    builder_reserve(builder,1);
+    builder->items[builder->length++] = character;
+    builder->items[builder->length] = '\0';
+}
+
+static void builder_append_bytes(CbsStringBuilder *builder,const char *bytes,size_t length){
+    builder_reserve(builder,length);
+    memcpy(&builder->items[builder->length],bytes,length);
+    builder->length += length;
+    builder->items[builder->length] = '\0';
+}
+
+//appends "string" followed by a space
+static void builder_append_quoted(CbsStringBuilder *builder,const char *string){
+    builder_append_char(builder,'"');
+    builder_append_string(builder,string);
+    builder_append_char(builder,'"');
+    builder_append_char(builder,' ');
+}
+
+static char* string_duplicate(const char *string){
+    size_t length = strlen(string);
+    char *copy = malloc(length + 1);
+    memcpy(copy,string,length + 1);
+    return copy;
+}
+
+typedef struct CbsStringList{
+    char **items;
+    int length;
+    int capacity;
+}CbsStringList;
+
+static void string_list_add(CbsStringList *list,const char *string){
+    if(list->length == list->capacity){
+        list->capacity = list->capacity == 0 ? 16 : list->capacity * 2;
+        list->items = realloc(list->items,sizeof(char*) * list->capacity);
+    }
+    list->items[list->length++] = string_duplicate(string);
+}
+
+static int compare_strings(const void *a,const void *b){
+    return strcmp(*(const char* const*)a,*(const char* const*)b);
+}
+
+static void string_list_free(CbsStringList *list){
+    for (int i = 0; i < list->length; i++) {
+        free(list->items[i]);
+    }
+    free(list->items);
+    list->items = NULL;
+    list->length = 0;
+    list->capacity = 0;
+}
+
+#define CBS_HASH_SEED 14695981039346656037ULL
+
+//FNV-1a, pass CBS_HASH_SEED or a previous result to chain
+static uint64_t hash_bytes(const void *data,size_t length,uint64_t hash){
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t hash_string(const char *string){
+    return hash_bytes(string,strlen(string),CBS_HASH_SEED);
+}
+
+//open addressing string -> pointer map, capacity is always a power of 2
+typedef struct CbsMapEntry{
+    char *key;
+    void *value;
+    uint64_t hash;
+}CbsMapEntry;
+
+typedef struct CbsMap{
+    CbsMapEntry *entries;
+    uint32_t capacity;
+    uint32_t length;
+}CbsMap;
+
+static CbsMapEntry* map_find_slot(CbsMapEntry *entries,uint32_t capacity,const char *key,uint64_t hash){
+    uint32_t index = (uint32_t)hash & (capacity - 1);
+    while(entries[index].key != NULL){
+        if(entries[index].hash == hash && strcmp(entries[index].key,key) == 0){
+            return &entries[index];
+        }
+        index = (index + 1) & (capacity - 1);
+    }
+    return &entries[index];
+}
+
+static void* map_get(const CbsMap *map,const char *key){
+    if(map->length == 0) return NULL;
+    CbsMapEntry *entry = map_find_slot(map->entries,map->capacity,key,hash_string(key));
+    return entry->key == NULL ? NULL : entry->value;
+}
+
+static void map_grow(CbsMap *map){
+    uint32_t capacity = map->capacity == 0 ? 64 : map->capacity * 2;
+    CbsMapEntry *entries = calloc(capacity,sizeof(CbsMapEntry));
+    for (uint32_t i = 0; i < map->capacity; i++) {
+        CbsMapEntry entry = map->entries[i];
+        if(entry.key == NULL) continue;
+        *map_find_slot(entries,capacity,entry.key,entry.hash) = entry;
+    }
+    free(map->entries);
+    map->entries = entries;
+    map->capacity = capacity;
+}
+
+static void map_put(CbsMap *map,const char *key,void *value){
+    if((map->length + 1) * 4 > map->capacity * 3){
+        map_grow(map);
+    }
+    uint64_t hash = hash_string(key);
+    CbsMapEntry *entry = map_find_slot(map->entries,map->capacity,key,hash);
+    if(entry->key == NULL){
+        entry->key = string_duplicate(key);
+        entry->hash = hash;
+        map->length++;
+    }
+    entry->value = value;
+}
+
+static void map_free(CbsMap *map,bool free_values){
+    for (uint32_t i = 0; i < map->capacity; i++) {
+        if(map->entries[i].key == NULL) continue;
+        free(map->entries[i].key);
+        if(free_values) free(map->entries[i].value);
+    }
+    free(map->entries);
+    map->entries = NULL;
+    map->capacity = 0;
+    map->length = 0;
+}
+
+// ==========================================
+// ============ SOURCE MATCHING =============
+// ==========================================
+
+//glob over '/' separated paths. * and ? stop at a '/', ** matches across any number of folders
+static bool glob_match(const char *pattern,const char *path){
+    while(*pattern != '\0'){
+        if(pattern[0] == '*' && pattern[1] == '*'){
+            pattern += 2;
+            if(*pattern == '\0') return true;
+            if(*pattern == '/'){
+                pattern++;
+                if(glob_match(pattern,path)) return true;
+                for (const char *c = path; *c != '\0'; c++) {
+                    if(*c == '/' && glob_match(pattern,c + 1)) return true;
+                }
+                return false;
+            }
+            for (const char *c = path; ; c++) {
+                if(glob_match(pattern,c)) return true;
+                if(*c == '\0') return false;
+            }
+        }
+        if(*pattern == '*'){
+            pattern++;
+            for (const char *c = path; ; c++) {
+                if(glob_match(pattern,c)) return true;
+                if(*c == '\0' || *c == '/') return false;
+            }
+        }
+        if(*path == '\0') return false;
+        if(*pattern == '?'){
+            if(*path == '/') return false;
+        }else if(*pattern != *path){
+            return false;
+        }
+        pattern++;
+        path++;
+    }
+    return *path == '\0';
+}
+
+static bool string_has_wildcard(const char *string){
+    return strpbrk(string,"*?") != NULL;
+}
+
+//source_patterns and source_files_to_exclude of a module, compiled once before scanning
+//all paths are relative to the project folder and use '/' on every platform
+typedef struct CbsSourceMatcher{
+    size_t root_length;
+    CbsStringList extensions;
+    CbsMap excluded_names;
+    CbsMap excluded_paths;
+    CbsMap excluded_directories;
+    CbsStringList excluded_directory_globs;
+    CbsStringList exclude_globs;
+    CbsMap included_paths;
+    CbsStringList include_globs;
+    //literal start of every include pattern, folders that can't lead to one of them aren't scanned
+    CbsStringList include_prefixes;
+}CbsSourceMatcher;
+
+static void normalize_pattern(const char *pattern,char *buffer){
+    if(string_starts_with(pattern,"./")) pattern += 2;
+    snprintf(buffer,FILE_PATH_MAX,"%s",pattern);
+    string_replace_all_char(buffer,'\\','/');
+}
+
+static void source_matcher_add_pattern(CbsSourceMatcher *matcher,const char *pattern){
+    char normalized[FILE_PATH_MAX];
+    bool exclude = pattern[0] == '!';
+    normalize_pattern(exclude ? &pattern[1] : pattern,normalized);
+
+    if(exclude){
+        if(string_ends_with_string(normalized,"/**")){
+            buffer_remove_characters_from_end(normalized,3);
+            if(string_has_wildcard(normalized)) string_list_add(&matcher->excluded_directory_globs,normalized);
+            else map_put(&matcher->excluded_directories,normalized,(void*)1);
+        }else if(string_has_wildcard(normalized)){
+            string_list_add(&matcher->exclude_globs,normalized);
+        }else{
+            map_put(&matcher->excluded_paths,normalized,(void*)1);
+        }
+        return;
+    }
+
+    char *wildcard = strpbrk(normalized,"*?");
+    if(wildcard == NULL){
+        map_put(&matcher->included_paths,normalized,(void*)1);
+    }else{
+        string_list_add(&matcher->include_globs,normalized);
+    }
+
+    char prefix[FILE_PATH_MAX];
+    snprintf(prefix,FILE_PATH_MAX,"%s",normalized);
+    if(wildcard != NULL){
+        prefix[wildcard - normalized] = '\0';
+    }
+    char *last_separator = strrchr(prefix,'/');
+    if(last_separator == NULL) prefix[0] = '\0';
+    else last_separator[1] = '\0';
+    string_list_add(&matcher->include_prefixes,prefix);
+}
+
+static void source_matcher_init(CbsSourceMatcher *matcher,const CbsModule *module,size_t root_length){
+    memset(matcher,0,sizeof(CbsSourceMatcher));
+    matcher->root_length = root_length;
+
+    if(module->source_file_extensions.length == 0){
+        string_list_add(&matcher->extensions,".c");
+    }
+    for (int i = 0; i < module->source_file_extensions.length; i++) {
+        string_list_add(&matcher->extensions,module->source_file_extensions.items[i]);
+    }
+
+    //plain file names exclude that name anywhere, anything with a folder in it is relative to the source folder
+    for (int i = 0; i < module->source_files_to_exclude.length; i++) {
+        const char *excluded = module->source_files_to_exclude.items[i];
+        if(strchr(excluded,'/') == NULL && strchr(excluded,'\\') == NULL){
+            map_put(&matcher->excluded_names,excluded,(void*)1);
+            continue;
+        }
+        char joined[FILE_PATH_MAX];
+        snprintf(joined,FILE_PATH_MAX,"!%s/%s",module->source_file_directory,excluded);
+        source_matcher_add_pattern(matcher,joined);
+    }
+
+    for (int i = 0; i < module->source_patterns.length; i++) {
+        source_matcher_add_pattern(matcher,module->source_patterns.items[i]);
+    }
+}
+
+static void source_matcher_free(CbsSourceMatcher *matcher){
+    string_list_free(&matcher->extensions);
+    map_free(&matcher->excluded_names,false);
+    map_free(&matcher->excluded_paths,false);
+    map_free(&matcher->excluded_directories,false);
+    string_list_free(&matcher->excluded_directory_globs);
+    string_list_free(&matcher->exclude_globs);
+    map_free(&matcher->included_paths,false);
+    string_list_free(&matcher->include_globs);
+    string_list_free(&matcher->include_prefixes);
+}
+
+//project relative, '/' separated copy of an absolute path, without a trailing separator
+static void source_matcher_relative_path(const CbsSourceMatcher *matcher,const char *absolute_path,char *buffer){
+    snprintf(buffer,FILE_PATH_MAX,"%s",&absolute_path[matcher->root_length]);
+    string_replace_all_char(buffer,'\\','/');
+    size_t length = strlen(buffer);
+    if(length > 0 && buffer[length - 1] == '/') buffer[length - 1] = '\0';
+}
+
+static bool source_matcher_should_enter(const CbsSourceMatcher *matcher,const char *directory_absolute_path){
+    char directory[FILE_PATH_MAX];
+    source_matcher_relative_path(matcher,directory_absolute_path,directory);
+    if(map_get(&matcher->excluded_directories,directory) != NULL) return false;
+    for (int i = 0; i < matcher->excluded_directory_globs.length; i++) {
+        if(glob_match(matcher->excluded_directory_globs.items[i],directory)) return false;
+    }
+
+    if(matcher->include_prefixes.length == 0) return true;
+    buffer_append_char(directory,FILE_PATH_MAX,'/');
+    for (int i = 0; i < matcher->include_prefixes.length; i++) {
+        const char *prefix = matcher->include_prefixes.items[i];
+        if(string_starts_with(prefix,directory) || string_starts_with(directory,prefix)) return true;
+    }
+    return false;
+}
+
+static bool source_matcher_matches_file(const CbsSourceMatcher *matcher,const char *file_absolute_path,const char *filename){
+    size_t filename_length = strlen(filename);
+    bool has_extension = false;
+    for (int i = 0; i < matcher->extensions.length; i++) {
+        const char *extension = matcher->extensions.items[i];
+        if(filename_length > strlen(extension) && string_ends_with_string(filename,extension)){
+            has_extension = true;
+            break;
+        }
+    }
+    if(has_extension == false) return false;
+    if(map_get(&matcher->excluded_names,filename) != NULL) return false;
+
+    char path[FILE_PATH_MAX];
+    source_matcher_relative_path(matcher,file_absolute_path,path);
+    if(map_get(&matcher->excluded_paths,path) != NULL) return false;
+    for (int i = 0; i < matcher->exclude_globs.length; i++) {
+        if(glob_match(matcher->exclude_globs.items[i],path)) return false;
+    }
+
+    if(matcher->included_paths.length == 0 && matcher->include_globs.length == 0) return true;
+    if(map_get(&matcher->included_paths,path) != NULL) return true;
+    for (int i = 0; i < matcher->include_globs.length; i++) {
+        if(glob_match(matcher->include_globs.items[i],path)) return true;
+    }
+    return false;
+}
+
+// ==========================================
+// ============ PLATFORM ====================
+// ==========================================
+
+//how copy_file_fast got the content across, cheapest first
+typedef enum CbsCopyMethod{
+    //shares the blocks of the source until one of them is written
+    CBS_COPY_CLONE,
+    //copied by the kernel without passing through user space
+    CBS_COPY_KERNEL,
+    CBS_COPY_HARDLINK,
+    CBS_COPY_BYTES,
+    CBS_COPY_FAILED
+}CbsCopyMethod;
+
 #ifdef _WIN32
+//one wait slot is kept for the interrupt event
+#define CBS_MAX_PARALLEL_PROCESSES (MAXIMUM_WAIT_OBJECTS - 1)
+
 static bool try_get_program_path(char* path_buffer){
     DWORD length = GetModuleFileNameA(NULL,path_buffer,FILE_PATH_MAX);
     if(length == 0 || length > FILE_PATH_MAX){
@@ -216,7 +724,8 @@ static bool try_get_program_path(char* path_buffer){
     return true;
 }
 
-static void add_files_recursive_from_source_directory(char* search_path, char* command_buffer,CbsStringArray files_to_exclude){
+//adds the matching files of one folder, folders inside it that could hold matches go to subdirectories
+static void add_files_from_source_directory(char* search_path, CbsStringList *source_files,CbsStringList *subdirectories,const CbsSourceMatcher *matcher){
     WIN32_FIND_DATAA find_data;
     const char wildcard = '*';
     buffer_append_char(search_path,FILE_PATH_MAX,wildcard);
@@ -237,43 +746,21 @@ static void add_files_recursive_from_source_directory(char* search_path, char* c
             continue;
         }
 
+        buffer_append_string(search_path,FILE_PATH_MAX,find_data.cFileName);
         if(find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY){
             //handle folder
-            buffer_append_string(search_path,FILE_PATH_MAX,find_data.cFileName);
-            buffer_append_char(search_path,FILE_PATH_MAX,FILE_SEPARATOR);
-            add_files_recursive_from_source_directory(search_path,command_buffer,files_to_exclude);
-            buffer_remove_characters_from_end(search_path,strlen(find_data.cFileName) +1);
-        }else{
-            //handle file
-            if(is_c_file(find_data.cFileName)==false){
-                continue;
-            }
-            if(files_to_exclude.length > 0){
-                bool should_exclude = false;
-                for (int i = 0; i<files_to_exclude.length; i++) {
-                    const char* excluded_filename = files_to_exclude.items[i];
-                    if(string_ends_with_string(find_data.cFileName, excluded_filename)){
-                        should_exclude = true;
-                        break;
-                    }
-                }
-                if(should_exclude == false){
-                    buffer_append_char(command_buffer,COMMAND_BUFFER_SIZE, '"');
-                    buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, search_path);
-                    buffer_append_string(command_buffer,COMMAND_BUFFER_SIZE, find_data.cFileName);
-                    buffer_append_char(command_buffer,COMMAND_BUFFER_SIZE, '"');
-                    buffer_append_char(command_buffer,COMMAND_BUFFER_SIZE, ' ');
-                }
-            } else{
-                buffer_append_char(command_buffer,COMMAND_BUFFER_SIZE, '"');
-                    buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, search_path);
-                    buffer_append_string(command_buffer,COMMAND_BUFFER_SIZE, find_data.cFileName);
-                    buffer_append_char(command_buffer,COMMAND_BUFFER_SIZE, '"');
-                    buffer_append_char(command_buffer,COMMAND_BUFFER_SIZE, ' ');
+            if(source_matcher_should_enter(matcher,search_path)){
+                buffer_append_char(search_path,FILE_PATH_MAX,FILE_SEPARATOR);
+                string_list_add(subdirectories,search_path);
+                buffer_remove_characters_from_end(search_path,1);
             }
-            
+        }else if(source_matcher_matches_file(matcher,search_path,find_data.cFileName)){
+            //handle file
+            string_list_add(source_files,search_path);
         }
+        buffer_remove_characters_from_end(search_path,strlen(find_data.cFileName));
     }while(FindNextFileA(hFind,&find_data));
+    FindClose(hFind);
 }
 
 void add_flags_to_buffer(char* buffer,size_t buffer_size, CbsModule module){
@@ -358,351 +845,5054 @@ void add_flags_to_buffer(char* buffer,size_t buffer_size, CbsModule module){
     }
 }
 
-void add_files_to_compile_commands_recursive(HANDLE file,char* path_buffer,CbsModule module,bool *first_block){
-    WIN32_FIND_DATAA find_data;
-    const char wildcard = '*';
-    buffer_append_char(path_buffer,FILE_PATH_MAX,wildcard);
-    HANDLE hFind = FindFirstFileA(path_buffer,&find_data);
-    if(hFind == INVALID_HANDLE_VALUE){
-        fprintf(stderr,"couldnt find initial files with path [%s]",path_buffer);
-        buffer_remove_characters_from_end(path_buffer,1);
-        return;
+static void add_file_to_compile_commands(HANDLE file,const char *source_path,CbsModule module,bool *first_block){
+    const char *filename = strrchr(source_path,FILE_SEPARATOR) + 1;
+    const size_t block_buffer_size = FILE_PATH_MAX *3;
+    char block_buffer[block_buffer_size];
+    block_buffer[0] = '\0';
+
+    if(*first_block == false){
+        buffer_append_char(block_buffer,block_buffer_size,',');
     }
-    buffer_remove_characters_from_end(path_buffer,1);
+    buffer_append_string(block_buffer,block_buffer_size,"\n\t{\n\t\t\"directory\" : \"");
+    char directory[FILE_PATH_MAX];
+    snprintf(directory,FILE_PATH_MAX,"%.*s",(int)(filename - source_path),source_path);
+    buffer_append_string(block_buffer,block_buffer_size,directory);
+    buffer_append_string(block_buffer,block_buffer_size,"\",\n\t\t\"command\" : \"");
+    add_flags_to_buffer(block_buffer,block_buffer_size,module);
+    buffer_append_string(block_buffer,block_buffer_size,"\",\n\t\t\"file\" : \"");
+    buffer_append_string(block_buffer,block_buffer_size,filename);
+    buffer_append_string(block_buffer,block_buffer_size,"\"\n\t}");
+    string_replace_all_char(block_buffer, '\\', '/');
 
-    do{
-        if(find_data.dwFileAttributes == INVALID_FILE_ATTRIBUTES){
-            continue;
-        }
-        if(strcmp(find_data.cFileName,".")==0
-        ||strcmp(find_data.cFileName,"..")==0){
-            continue;
-        }
+    WriteFile(file,
+        block_buffer,
+        strlen(block_buffer),
+        NULL,
+        NULL
+    );
+    *first_block = false;
+}
 
-        if(find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY){
-            //handle folder
-            buffer_append_string(path_buffer,FILE_PATH_MAX,find_data.cFileName);
-            buffer_append_char(path_buffer,FILE_PATH_MAX,FILE_SEPARATOR);
-            add_files_to_compile_commands_recursive(file,path_buffer,module,first_block);
-            buffer_remove_characters_from_end(path_buffer,strlen(find_data.cFileName) +1);
-        }else{
-            //handle file
-            if(is_c_file(find_data.cFileName)==false){
-                continue;
-            }
-            const size_t block_buffer_size = FILE_PATH_MAX *3;
-            char block_buffer[block_buffer_size];
-            block_buffer[0] = '\0';
-
-            if(*first_block == false){
-                buffer_append_char(block_buffer,block_buffer_size,',');    
-            }
-            buffer_append_string(block_buffer,block_buffer_size,"\n\t{\n\t\t\"directory\" : \"");
-            buffer_append_string(block_buffer,block_buffer_size,path_buffer);
-            buffer_append_string(block_buffer,block_buffer_size,"\",\n\t\t\"command\" : \"");
-            add_flags_to_buffer(block_buffer,block_buffer_size,module);
-            buffer_append_string(block_buffer,block_buffer_size,"\",\n\t\t\"file\" : \"");
-            buffer_append_string(block_buffer,block_buffer_size,find_data.cFileName);
-            buffer_append_string(block_buffer,block_buffer_size,"\"\n\t}");
-            string_replace_all_char(block_buffer, '\\', '/');
-            
-            WriteFile(file,
-                block_buffer,
-                strlen(block_buffer),
-                NULL,
-                NULL
-            );
-            *first_block = false;
-        }
-    }while(FindNextFileA(hFind,&find_data));
+//the pipe stdout and stderr of a process share, with the read that's always pending on it.
+//kept apart from CbsProcess since the system holds on to the OVERLAPPED while a slot gets moved
+typedef struct CbsProcessOutput{
+    HANDLE pipe;
+    OVERLAPPED overlapped;
+    bool read_pending;
+    char buffer[4096];
+}CbsProcessOutput;
+
+typedef struct CbsProcess{
+    HANDLE handle;
+    //job object holding the process and everything it starts, so all of them can be killed at once
+    HANDLE job;
+    //NULL once the pipe hit end of file or got closed by a kill
+    CbsProcessOutput *output;
+}CbsProcess;
+
+//processes running at the same time and the output each has written so far
+typedef struct CbsProcessPool{
+    CbsProcess *processes;
+    CbsStringBuilder *outputs;
+    int count;
+    int capacity;
+}CbsProcessPool;
+
+//set by Ctrl-C or closing the console, nothing starts after that and running processes get killed
+static volatile LONG cbs_interrupted = 0;
+static HANDLE cbs_interrupt_event = NULL;
+
+static BOOL WINAPI console_interrupt_handler(DWORD event){
+    if(event != CTRL_C_EVENT && event != CTRL_BREAK_EVENT && event != CTRL_CLOSE_EVENT) return FALSE;
+    cbs_interrupted = 1;
+    SetEvent(cbs_interrupt_event);
+    return TRUE;
 }
 
-void create_compile_commands_json(const CbsModule *module_array,const int array_length){
-    
-    char path_buffer[FILE_PATH_MAX];
-    DWORD bytes = GetCurrentDirectoryA(FILE_PATH_MAX, path_buffer);
-    path_buffer[bytes+1] = '\0';
+static void install_interrupt_handler(void){
+    if(cbs_interrupt_event != NULL) return;
+    cbs_interrupt_event = CreateEventA(NULL,TRUE,FALSE,NULL);
+    SetConsoleCtrlHandler(console_interrupt_handler,TRUE);
+}
 
-    const char* cc = "compile_commands.json";
-    buffer_append_char(path_buffer,FILE_PATH_MAX,FILE_SEPARATOR);
-    buffer_append_string(path_buffer, FILE_PATH_MAX,cc);
-    
-    HANDLE file = CreateFileA(
-        path_buffer,
-        GENERIC_READ | GENERIC_WRITE,
-        0,
-        NULL,
-        CREATE_ALWAYS,
-        FILE_ATTRIBUTE_NORMAL,
-        NULL
-    );
-    WriteFile(file,"[\n",2,NULL,NULL);
-    
-    if(file == INVALID_HANDLE_VALUE){
-        fprintf(stderr,"couldn't create file at [%s]\n",path_buffer);
-        buffer_remove_characters_from_end(path_buffer, strlen(cc));
-        return;
+static void process_pool_init(CbsProcessPool *pool,int capacity){
+    install_interrupt_handler();
+    pool->processes = calloc(capacity,sizeof(CbsProcess));
+    pool->outputs = calloc(capacity,sizeof(CbsStringBuilder));
+    pool->count = 0;
+    pool->capacity = capacity;
+}
+
+static void process_pool_free(CbsProcessPool *pool){
+    free(pool->processes);
+    free(pool->outputs);
+}
+
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+
+//children write to a pipe, so the console has to be asked to turn the escape codes they print back into colors
+static bool output_is_terminal(void){
+    HANDLE output = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    if(output == INVALID_HANDLE_VALUE || GetConsoleMode(output,&mode) == FALSE) return false;
+    if(mode & ENABLE_VIRTUAL_TERMINAL_PROCESSING) return true;
+    return SetConsoleMode(output,mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING) != FALSE;
+}
+
+//our environment with the NAME=value variable added, NULL when it's already set and ours can be inherited
+static char* environment_block_with(const char *variable){
+    char *current = GetEnvironmentStringsA();
+    if(current == NULL) return NULL;
+    size_t name_length = strcspn(variable,"=") + 1;
+    const char *end = current;
+    bool already_set = false;
+    while(*end != '\0'){
+        //names don't care about case on windows
+        if(_strnicmp(end,variable,name_length) == 0) already_set = true;
+        end += strlen(end) + 1;
+    }
+    char *block = NULL;
+    if(already_set == false){
+        size_t current_length = (size_t)(end - current);
+        size_t variable_length = strlen(variable) + 1;
+        block = malloc(current_length + variable_length + 1);
+        memcpy(block,current,current_length);
+        memcpy(&block[current_length],variable,variable_length);
+        block[current_length + variable_length] = '\0';
     }
+    FreeEnvironmentStringsA(current);
+    return block;
+}
 
-    buffer_remove_characters_from_end(path_buffer, strlen(cc));
-    bool first_block = true;
-    for(int i = 0; i < array_length; i++){
-        CbsModule module = module_array[i];
-        if(module.source_file_directory != NULL){
-            size_t chars_to_remove = strlen(module.source_file_directory);
-            buffer_append_string(path_buffer, FILE_PATH_MAX, module.source_file_directory);
-            if(string_ends_with_char(module.source_file_directory,FILE_SEPARATOR)==false){
-                buffer_append_char(path_buffer, FILE_PATH_MAX, FILE_SEPARATOR);
-                chars_to_remove++;
+//an overlapped pipe for the child to write into. the write end is inheritable and goes to the child,
+//which is fine as long as it's closed right after CreateProcessA since nothing else starts in between
+static CbsProcessOutput* create_output_pipe(HANDLE *write_end){
+    //anonymous pipes can't do overlapped reads, so every process gets its own named one
+    static LONG pipe_counter = 0;
+    char name[64];
+    snprintf(name,sizeof(name),"\\\\.\\pipe\\cbs-%lu-%ld",(unsigned long)GetCurrentProcessId(),(long)InterlockedIncrement(&pipe_counter));
+    HANDLE pipe = CreateNamedPipeA(name,PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED,PIPE_TYPE_BYTE | PIPE_WAIT,1,4096,4096,0,NULL);
+    if(pipe == INVALID_HANDLE_VALUE) return NULL;
+    SECURITY_ATTRIBUTES inherit = { sizeof(inherit), NULL, TRUE };
+    *write_end = CreateFileA(name,GENERIC_WRITE,0,&inherit,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+    if(*write_end == INVALID_HANDLE_VALUE){
+        CloseHandle(pipe);
+        return NULL;
+    }
+    CbsProcessOutput *output = calloc(1,sizeof(CbsProcessOutput));
+    output->pipe = pipe;
+    output->overlapped.hEvent = CreateEventA(NULL,TRUE,FALSE,NULL);
+    return output;
+}
+
+//cancels the read still pending and waits for that, the OVERLAPPED has to outlive it
+static void close_output_pipe(CbsProcessOutput *output){
+    if(output->read_pending){
+        DWORD bytes = 0;
+        CancelIoEx(output->pipe,&output->overlapped);
+        GetOverlappedResult(output->pipe,&output->overlapped,&bytes,TRUE);
+    }
+    CloseHandle(output->pipe);
+    CloseHandle(output->overlapped.hEvent);
+    free(output);
+}
+
+//takes what the reads got and starts the next one, until one stays pending.
+//the pipe is closed once the child has closed it
+static void process_pool_drain(CbsProcessPool *pool,int slot){
+    CbsProcessOutput *output = pool->processes[slot].output;
+    DWORD bytes = 0;
+    while(true){
+        if(output->read_pending){
+            if(GetOverlappedResult(output->pipe,&output->overlapped,&bytes,FALSE) == FALSE){
+                if(GetLastError() == ERROR_IO_INCOMPLETE) return;
+                output->read_pending = false;
+                break;
             }
-            add_files_to_compile_commands_recursive(file, path_buffer, module, &first_block);
-            buffer_remove_characters_from_end(path_buffer,chars_to_remove);
-        }else{
-            add_files_to_compile_commands_recursive(file, path_buffer, module, &first_block);
+            output->read_pending = false;
+            builder_append_bytes(&pool->outputs[slot],output->buffer,(size_t)bytes);
+        }
+        //a read finishing right away still signals the event and is picked up by GetOverlappedResult
+        if(ReadFile(output->pipe,output->buffer,sizeof(output->buffer),NULL,&output->overlapped) == FALSE && GetLastError() != ERROR_IO_PENDING){
+            break;
         }
+        output->read_pending = true;
     }
-    WriteFile(file,"\n]\n",3,NULL,NULL);
-
-    CloseHandle(file);
+    close_output_pipe(output);
+    pool->processes[slot].output = NULL;
 }
 
-static void run_command_line(char* command_line){
-    STARTUPINFO si = { 0 };
-    PROCESS_INFORMATION pi = { 0 };   
+//working_directory NULL keeps ours. environment is a NAME=value the child gets unless it's already set, or NULL
+static bool process_pool_start(CbsProcessPool *pool,const char* command_line,const char *working_directory,const char *environment){
+    if(cbs_interrupted) return false;
+    HANDLE write_end = INVALID_HANDLE_VALUE;
+    CbsProcessOutput *output = create_output_pipe(&write_end);
+    if(output == NULL){
+        cbs_log_error("CreateNamedPipe failed (%d) for [%s]",(int)GetLastError(),command_line);
+        return false;
+    }
+    //children read NUL as stdin so none of them sits waiting on the console
+    SECURITY_ATTRIBUTES inherit = { sizeof(inherit), NULL, TRUE };
+    HANDLE null_input = CreateFileA("NUL",GENERIC_READ,FILE_SHARE_READ | FILE_SHARE_WRITE,&inherit,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+
+    STARTUPINFOA si = { 0 };
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = null_input;
+    si.hStdOutput = write_end;
+    si.hStdError = write_end;
+    PROCESS_INFORMATION pi = { 0 };
 
-    // Create the process
+    //CreateProcessA is allowed to write to the command line buffer
+    char *mutable_command_line = string_duplicate(command_line);
+    char *environment_block = environment != NULL ? environment_block_with(environment) : NULL;
     BOOL success = CreateProcessA(
-        NULL,           
-        command_line,        
-        NULL,           
-        NULL,           
-        FALSE,          
-        0,              
-        NULL,           
-        NULL,        
-        &si,            
-        &pi      
+        NULL,
+        mutable_command_line,
+        NULL,
+        NULL,
+        TRUE,
+        CREATE_SUSPENDED,
+        environment_block,
+        working_directory,
+        &si,
+        &pi
     );
+    DWORD error = GetLastError();
+    free(mutable_command_line);
+    free(environment_block);
+    //only the child keeps the write end, so the pipe hits end of file once it and everything it started are done
+    CloseHandle(write_end);
+    if(null_input != INVALID_HANDLE_VALUE) CloseHandle(null_input);
 
     if (!success) {
-        DWORD last_error =GetLastError();
-        printf("CreateProcess failed (%d).\n", (int)last_error);
-        return;
+        cbs_log_error("CreateProcess failed (%d) for [%s]", (int)error,command_line);
+        close_output_pipe(output);
+        return false;
     }
 
-    WaitForSingleObject(pi.hProcess, INFINITE);
-
-    DWORD exit_code;
-    GetExitCodeProcess(pi.hProcess, &exit_code);
-    if (exit_code != 0) {
-        cbs_log_error("Compiler exited with code %d", (int)exit_code);
+    //the process joins its job object before it runs, so nothing it starts can escape the job
+    HANDLE job = CreateJobObjectA(NULL,NULL);
+    if(job != NULL && AssignProcessToJobObject(job,pi.hProcess) == FALSE){
+        CloseHandle(job);
+        job = NULL;
     }
-
-    CloseHandle(pi.hProcess);
+    ResumeThread(pi.hThread);
     CloseHandle(pi.hThread);
-}
-#elif defined(__linux__)
-static bool try_get_program_path(char* path_buffer){
-    ssize_t length = readlink("/proc/self/exe", path_buffer, FILE_PATH_MAX - 1);
-    if (length == -1) {
-        return false; // readlink failed
-    }
-    path_buffer[length] = '\0'; // Null-terminate the string
-    remove_filename_from_path(path_buffer,length);
+    pool->processes[pool->count].handle = pi.hProcess;
+    pool->processes[pool->count].job = job;
+    pool->processes[pool->count].output = output;
+    pool->outputs[pool->count].length = 0;
+    pool->count++;
+    process_pool_drain(pool,pool->count - 1);
     return true;
 }
-static void add_files_recursive_from_source_directory(char* search_path, char* command_buffer){
-    //TODO implement this method
-}
-static void create_compile_commands_json(CbsModule* module_array,int array_length){
-       //TODO implement this method
-}
-static void run_command_line(char* command){
-    //fork(command);
-    //TODO implement this method properly
+
+static void process_close(CbsProcess *process){
+    CloseHandle(process->handle);
+    if(process->job != NULL) CloseHandle(process->job);
 }
-#elif defined(__APPLE__)
-static bool try_get_program_path(char* path_buffer){
+
+//returns the slot of a process that exited, -1 if none has within timeout_ms, -2 on failure
+//or -3 once interrupted. a negative timeout_ms waits as long as it takes
+//a process counts as exited once its pipe hits end of file, then it gets reaped
+static int process_pool_wait(CbsProcessPool *pool,int timeout_ms,int *exit_code){
+    uint64_t deadline_ms = (uint64_t)GetTickCount64() + (uint64_t)(timeout_ms < 0 ? 0 : timeout_ms);
+    while(true){
+        for (int slot = 0; slot < pool->count; slot++) {
+            CbsProcess *process = &pool->processes[slot];
+            if(process->output != NULL) continue;
+            DWORD code = 1;
+            WaitForSingleObject(process->handle,INFINITE);
+            GetExitCodeProcess(process->handle,&code);
+            process_close(process);
+            *exit_code = (int)code;
+            return slot;
+        }
+        if(cbs_interrupted) return -3;
+        if(pool->count == 0) return -1;
+        //output arriving doesn't restart the timeout
+        DWORD remaining_ms = INFINITE;
+        if(timeout_ms >= 0){
+            uint64_t now_ms = (uint64_t)GetTickCount64();
+            remaining_ms = now_ms >= deadline_ms ? 0 : (DWORD)(deadline_ms - now_ms);
+        }
+
+        //every process has a read pending here, its event is set once that read finishes
+        HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+        for (int i = 0; i < pool->count; i++) {
+            handles[i] = pool->processes[i].output->overlapped.hEvent;
+        }
+        handles[pool->count] = cbs_interrupt_event;
+
+        DWORD result = WaitForMultipleObjects((DWORD)pool->count + 1,handles,FALSE,remaining_ms);
+        if(result == WAIT_TIMEOUT) return -1;
+        if(result == WAIT_OBJECT_0 + (DWORD)pool->count) return -3;
+        if(result > WAIT_OBJECT_0 + (DWORD)pool->count){
+            cbs_log_error("WaitForMultipleObjects failed (%d)",(int)GetLastError());
+            return -2;
+        }
+        process_pool_drain(pool,(int)(result - WAIT_OBJECT_0));
+    }
+}
+
+//kills the process and everything it started, it still has to be collected with process_pool_wait.
+//its pipe is closed right away in case something outside the job keeps it open
+static void process_pool_kill(CbsProcessPool *pool,int slot){
+    CbsProcess *process = &pool->processes[slot];
+    if(process->job == NULL || TerminateJobObject(process->job,1) == FALSE){
+        TerminateProcess(process->handle,1);
+    }
+    if(process->output != NULL){
+        close_output_pipe(process->output);
+        process->output = NULL;
+    }
+}
+
+//kills every process and waits until they're gone, their output is thrown away
+static void process_pool_cancel(CbsProcessPool *pool){
+    for (int slot = 0; slot < pool->count; slot++) {
+        process_pool_kill(pool,slot);
+    }
+    for (int slot = 0; slot < pool->count; slot++) {
+        WaitForSingleObject(pool->processes[slot].handle,INFINITE);
+        process_close(&pool->processes[slot]);
+        free(pool->outputs[slot].items);
+        memset(&pool->outputs[slot],0,sizeof(CbsStringBuilder));
+    }
+    pool->count = 0;
+}
+
+static uint64_t time_now_ms(void){
+    return (uint64_t)GetTickCount64();
+}
+
+static uint64_t time_now_ns(void){
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+}
+
+static DWORD_PTR saved_affinity_mask = 0;
+
+//processes started while pinned inherit the cpu, a negative cpu restores the mask from before
+static bool pin_to_cpu(int cpu){
+    HANDLE process = GetCurrentProcess();
+    if(cpu < 0){
+        if(saved_affinity_mask == 0) return true;
+        bool restored = SetProcessAffinityMask(process,saved_affinity_mask);
+        saved_affinity_mask = 0;
+        return restored;
+    }
+    DWORD_PTR system_mask = 0;
+    if(cpu >= (int)(sizeof(DWORD_PTR) * 8)) return false;
+    if(saved_affinity_mask == 0 && GetProcessAffinityMask(process,&saved_affinity_mask,&system_mask) == false) return false;
+    return SetProcessAffinityMask(process,(DWORD_PTR)1 << cpu);
+}
+
+static int processor_count(void){
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+}
+
+static bool make_directory(const char *path){
+    if(CreateDirectoryA(path,NULL)) return true;
+    return GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+static bool try_get_file_modified_time(const char *path,int64_t *modified_ns){
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if(GetFileAttributesExA(path,GetFileExInfoStandard,&data) == false){
+        return false;
+    }
+    //100ns ticks, only ever compared against each other
+    uint64_t ticks = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+    *modified_ns = (int64_t)(ticks * 100);
+    return true;
+}
+
+//takes a time from try_get_file_modified_time
+static bool set_file_modified_time(const char *path,int64_t modified_ns){
+    HANDLE file = CreateFileA(path,FILE_WRITE_ATTRIBUTES,FILE_SHARE_READ | FILE_SHARE_WRITE,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+    if(file == INVALID_HANDLE_VALUE) return false;
+    uint64_t ticks = (uint64_t)modified_ns / 100;
+    FILETIME time;
+    time.dwLowDateTime = (DWORD)ticks;
+    time.dwHighDateTime = (DWORD)(ticks >> 32);
+    BOOL success = SetFileTime(file,NULL,NULL,&time);
+    CloseHandle(file);
+    return success != FALSE;
+}
+
+typedef struct CbsMappedFile{
+    const char *data;
+    size_t size;
+    HANDLE file;
+    HANDLE mapping;
+}CbsMappedFile;
+
+static bool file_map(const char *path,CbsMappedFile *mapped){
+    memset(mapped,0,sizeof(CbsMappedFile));
+    mapped->file = CreateFileA(path,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+    if(mapped->file == INVALID_HANDLE_VALUE){
+        return false;
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(mapped->file,&size);
+    mapped->size = (size_t)size.QuadPart;
+    if(mapped->size == 0){
+        return true;
+    }
+    mapped->mapping = CreateFileMappingA(mapped->file,NULL,PAGE_READONLY,0,0,NULL);
+    if(mapped->mapping != NULL){
+        mapped->data = MapViewOfFile(mapped->mapping,FILE_MAP_READ,0,0,0);
+    }
+    if(mapped->data == NULL){
+        if(mapped->mapping != NULL) CloseHandle(mapped->mapping);
+        CloseHandle(mapped->file);
+        return false;
+    }
+    return true;
+}
+
+static void file_unmap(CbsMappedFile *mapped){
+    if(mapped->data != NULL) UnmapViewOfFile(mapped->data);
+    if(mapped->mapping != NULL) CloseHandle(mapped->mapping);
+    CloseHandle(mapped->file);
+}
+
+//to must not exist yet. CopyFile clones the blocks itself where the file system can, like ReFS on a dev drive
+static CbsCopyMethod copy_file_fast(const char *from,const char *to){
+    if(CopyFileA(from,to,TRUE)) return CBS_COPY_KERNEL;
+    if(CreateHardLinkA(to,from,NULL)) return CBS_COPY_HARDLINK;
+    return CBS_COPY_FAILED;
+}
+
+//true when both paths are hard links to one file
+static bool files_are_same(const char *a,const char *b){
+    BY_HANDLE_FILE_INFORMATION infos[2];
+    const char *paths[2] = {a,b};
+    for (int i = 0; i < 2; i++) {
+        HANDLE file = CreateFileA(paths[i],0,FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+        if(file == INVALID_HANDLE_VALUE) return false;
+        bool found = GetFileInformationByHandle(file,&infos[i]);
+        CloseHandle(file);
+        if(found == false) return false;
+    }
+    return infos[0].dwVolumeSerialNumber == infos[1].dwVolumeSerialNumber
+        && infos[0].nFileIndexHigh == infos[1].nFileIndexHigh
+        && infos[0].nFileIndexLow == infos[1].nFileIndexLow;
+}
+
+#else
+#include<sys/wait.h>
+#include<signal.h>
+#include<time.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<sys/mman.h>
+#if defined(__linux__)
+#include<sys/epoll.h>
+#include<sys/syscall.h>
+#include<sys/ioctl.h>
+#ifndef FICLONE
+#define FICLONE _IOW(0x94,9,int)
+#endif
+#else
+#include<poll.h>
+#include<sys/clonefile.h>
+#endif
+#define CBS_MAX_PARALLEL_PROCESSES 1024
+
+#if defined(__linux__)
+static bool try_get_program_path(char* path_buffer){
+    ssize_t length = readlink("/proc/self/exe", path_buffer, FILE_PATH_MAX - 1);
+    if (length == -1) {
+        return false; // readlink failed
+    }
+    path_buffer[length] = '\0'; // Null-terminate the string
+    remove_filename_from_path(path_buffer,length);
+    return true;
+}
+#elif defined(__APPLE__)
+static bool try_get_program_path(char* path_buffer){
     uint32_t size = FILE_PATH_MAX;
     if (_NSGetExecutablePath(path_buffer, &size) != 0) {
         // Buffer too small, but size now contains required length
         path_buffer[0] = '\0';
         return false;
-    } 
+    }
+    remove_filename_from_path(path_buffer,strlen(path_buffer));
     return true;
 }
-static void add_files_recursive_from_source_directory(char* search_path, char* command_buffer){
-    //TODO implement this method
+#endif
+
+//adds the matching files of one folder, folders inside it that could hold matches go to subdirectories
+static void add_files_from_source_directory(char* search_path, CbsStringList *source_files,CbsStringList *subdirectories,const CbsSourceMatcher *matcher){
+    DIR *directory = opendir(search_path);
+    if(directory == NULL){
+        cbs_log_error("couldnt open directory [%s]",search_path);
+        return;
+    }
+
+    struct dirent *entry;
+    while((entry = readdir(directory)) != NULL){
+        if(strcmp(entry->d_name,".")==0
+        ||strcmp(entry->d_name,"..")==0){
+            continue;
+        }
+
+        buffer_append_string(search_path,FILE_PATH_MAX,entry->d_name);
+        bool is_directory = entry->d_type == DT_DIR;
+        if(entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK){
+            struct stat info;
+            is_directory = stat(search_path,&info) == 0 && S_ISDIR(info.st_mode);
+        }
+
+        if(is_directory){
+            //handle folder
+            if(source_matcher_should_enter(matcher,search_path)){
+                buffer_append_char(search_path,FILE_PATH_MAX,FILE_SEPARATOR);
+                string_list_add(subdirectories,search_path);
+                buffer_remove_characters_from_end(search_path,1);
+            }
+        }else if(source_matcher_matches_file(matcher,search_path,entry->d_name)){
+            //handle file
+            string_list_add(source_files,search_path);
+        }
+        buffer_remove_characters_from_end(search_path,strlen(entry->d_name));
+    }
+    closedir(directory);
 }
-static void create_compile_commands_json(CbsModule* module_array,int array_length){
-       //TODO implement this method
+
+void create_compile_commands_json(const CbsModule *module_array,const int array_length){
+    //TODO implement this method
+    (void)module_array;
+    (void)array_length;
 }
-static void create_compile_commands_json(CbsModule* module_array,int array_length){
-       //TODO implement this method
+
+static uint64_t time_now_ms(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
 }
-static void run_command_line(char* command){
-    //exec(command);
-    //TODO implement this method properly
+
+static uint64_t time_now_ns(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
 }
-    
-#endif
 
+typedef struct CbsProcess{
+    pid_t pid;
+    //read ends of stdout and stderr, -1 once the child has closed them
+    int output_fds[2];
+}CbsProcess;
 
+//processes running at the same time and the output each has written so far
+typedef struct CbsProcessPool{
+    CbsProcess *processes;
+    CbsStringBuilder *outputs;
+    int count;
+    int capacity;
+#if defined(__linux__)
+    int epoll_fd;
+#else
+    struct pollfd *poll_fds;
+#endif
+}CbsProcessPool;
 
-static bool directory_exists(const char *path){
-    struct stat info;
-    if(stat(path,&info) != 0){
-        return false;
-    }
-    return (info.st_mode & S_IFDIR) != 0;
+//set by SIGINT or SIGTERM, nothing starts after that and running processes get killed.
+//the handler also writes to a pipe so a wait that is already blocking wakes up
+static volatile sig_atomic_t cbs_interrupted = 0;
+static int cbs_interrupt_pipe[2] = {-1,-1};
+#define CBS_INTERRUPT_EVENT UINT64_MAX
+
+static void interrupt_handler(int signal_number){
+    (void)signal_number;
+    cbs_interrupted = 1;
+    int saved_errno = errno;
+    if(write(cbs_interrupt_pipe[1],"",1) < 0){}
+    errno = saved_errno;
 }
 
-void cbs_module_compile(CbsModule module){
-    if(string_is_null_empty_or_whitespace(module.name)){
-        cbs_log_error("[name] variable in the module struct is NULL. Must provide name");
+static void install_interrupt_handler(void){
+    if(cbs_interrupt_pipe[0] != -1) return;
+    if(pipe(cbs_interrupt_pipe) != 0){
+        cbs_interrupt_pipe[0] = -1;
         return;
     }
-    if(string_is_null_empty_or_whitespace(module.compiler)){
-        cbs_log_error("[compiler] variable in module [%s] is null,empty or whitespace",module.name);
-        return;
+    for (int i = 0; i < 2; i++) {
+        fcntl(cbs_interrupt_pipe[i],F_SETFD,FD_CLOEXEC);
+        fcntl(cbs_interrupt_pipe[i],F_SETFL,O_NONBLOCK);
     }
-    if(string_is_null_empty_or_whitespace(module.output_directory)){
-        cbs_log_error("[output_directory] variable in module [%s] is null,empty or whitespace",module.name);
-        return;
+    //no SA_RESTART, a blocking wait has to return
+    struct sigaction action;
+    memset(&action,0,sizeof(action));
+    action.sa_handler = interrupt_handler;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT,&action,NULL);
+    sigaction(SIGTERM,&action,NULL);
+}
+
+static void process_pool_init(CbsProcessPool *pool,int capacity){
+    install_interrupt_handler();
+    pool->processes = calloc(capacity,sizeof(CbsProcess));
+    pool->outputs = calloc(capacity,sizeof(CbsStringBuilder));
+    pool->count = 0;
+    pool->capacity = capacity;
+#if defined(__linux__)
+    pool->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if(cbs_interrupt_pipe[0] != -1){
+        struct epoll_event event = {0};
+        event.events = EPOLLIN;
+        event.data.u64 = CBS_INTERRUPT_EVENT;
+        epoll_ctl(pool->epoll_fd,EPOLL_CTL_ADD,cbs_interrupt_pipe[0],&event);
     }
-    if(string_is_null_empty_or_whitespace(module.output_file_name_with_extension)){
-        cbs_log_error("[output_file_name_with_extension] variable in module [%s] is null,empty or whitespace",module.name);
-        return;
+#else
+    //one more for the interrupt pipe
+    pool->poll_fds = calloc(capacity * 2 + 1,sizeof(struct pollfd));
+#endif
+}
+
+static void process_pool_free(CbsProcessPool *pool){
+    free(pool->processes);
+    free(pool->outputs);
+#if defined(__linux__)
+    close(pool->epoll_fd);
+#else
+    free(pool->poll_fds);
+#endif
+}
+
+static bool output_is_terminal(void){
+    return isatty(STDOUT_FILENO) != 0;
+}
+
+//close on exec so a pipe only ever reaches the one child it was made for
+static bool create_output_pipe(int *fds){
+    if(pipe(fds) != 0) return false;
+    fcntl(fds[0],F_SETFD,FD_CLOEXEC);
+    fcntl(fds[1],F_SETFD,FD_CLOEXEC);
+    return true;
+}
+
+//working_directory NULL keeps ours. environment is a NAME=value the child gets unless it's already set, or NULL
+static bool process_pool_start(CbsProcessPool *pool,const char* command_line,const char *working_directory,const char *environment){
+    if(cbs_interrupted) return false;
+    int stdout_pipe[2];
+    int stderr_pipe[2];
+    if(create_output_pipe(stdout_pipe) == false){
+        cbs_log_error("pipe failed (%d) for [%s]",errno,command_line);
+        return false;
     }
-    if(string_is_null_empty_or_whitespace(module.source_file_directory)){
-        cbs_log_error("[source_file_directory] variable in module [%s] is null,empty or whitespace",module.name);
-        return;
+    if(create_output_pipe(stderr_pipe) == false){
+        cbs_log_error("pipe failed (%d) for [%s]",errno,command_line);
+        close(stdout_pipe[0]);
+        close(stdout_pipe[1]);
+        return false;
     }
-    
-    if(directory_exists(module.output_directory)==false){
-        cbs_log_error("output directory [%s] in module [%s] doesnt exist",module.output_directory,module.name);
-        return;
+
+    pid_t pid = fork();
+    if(pid == -1){
+        cbs_log_error("fork failed (%d) for [%s]",errno,command_line);
+        close(stdout_pipe[0]);
+        close(stdout_pipe[1]);
+        close(stderr_pipe[0]);
+        close(stderr_pipe[1]);
+        return false;
     }
-    if(directory_exists(module.source_file_directory)==false){
-        cbs_log_error("source file directory [%s] in module [%s] doesnt exist",module.output_directory,module.name);
-        return;
+    //every process gets its own group so a kill reaches the compiler behind the shell and anything it started.
+    //both sides set it so it's in place whichever runs first
+    if(pid == 0){
+        setpgid(0,0);
+        dup2(stdout_pipe[1],STDOUT_FILENO);
+        dup2(stderr_pipe[1],STDERR_FILENO);
+        if(working_directory != NULL && chdir(working_directory) != 0){
+            _exit(127);
+        }
+        //only the child's copy of the environment changes
+        if(environment != NULL){
+            char name[256];
+            snprintf(name,sizeof(name),"%.*s",(int)strcspn(environment,"="),environment);
+            if(getenv(name) == NULL) putenv((char*)environment);
+        }
+        execl("/bin/sh","sh","-c",command_line,(char*)NULL);
+        _exit(127);
     }
-    char command_buffer[COMMAND_BUFFER_SIZE];
+    setpgid(pid,pid);
+    close(stdout_pipe[1]);
+    close(stderr_pipe[1]);
 
-    //add compiler to command buffer
-    buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, module.compiler);
-    buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE,' ');
+    CbsProcess *process = &pool->processes[pool->count];
+    process->pid = pid;
+    process->output_fds[0] = stdout_pipe[0];
+    process->output_fds[1] = stderr_pipe[0];
+    for (int i = 0; i < 2; i++) {
+        fcntl(process->output_fds[i],F_SETFL,O_NONBLOCK);
+#if defined(__linux__)
+        struct epoll_event event = {0};
+        event.events = EPOLLIN;
+        event.data.u64 = ((uint64_t)pid << 1) | (uint64_t)i;
+        epoll_ctl(pool->epoll_fd,EPOLL_CTL_ADD,process->output_fds[i],&event);
+#endif
+    }
+    pool->outputs[pool->count].length = 0;
+    pool->count++;
+    return true;
+}
 
-    //add compiler flags
-    for (int i = 0; i < module.shared_compiler_flags.length; i++) {
-        const char* compiler_flag = module.shared_compiler_flags.items[i];
-        if(string_starts_with(compiler_flag, "-") == false){
-            buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, "-");
+//reads everything available on one of the pipes and closes it once the child has
+static void process_pool_drain(CbsProcessPool *pool,int slot,int stream){
+    CbsProcess *process = &pool->processes[slot];
+    int fd = process->output_fds[stream];
+    char buffer[4096];
+    while(true){
+        ssize_t bytes = read(fd,buffer,sizeof(buffer));
+        if(bytes > 0){
+            builder_append_bytes(&pool->outputs[slot],buffer,(size_t)bytes);
+            continue;
         }
-        buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, compiler_flag);
-        buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE,' ');
+        if(bytes < 0 && errno == EINTR) continue;
+        if(bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        break;
     }
-    for (int i = 0; i < module.unique_compiler_flags.length; i++) {
-        const char* compiler_flag = module.unique_compiler_flags.items[i];
-        if(string_starts_with(compiler_flag, "-") == false){
-            buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, "-");
+#if defined(__linux__)
+    epoll_ctl(pool->epoll_fd,EPOLL_CTL_DEL,fd,NULL);
+#endif
+    close(fd);
+    process->output_fds[stream] = -1;
+}
+
+//returns the slot of a process that exited, -1 if none has within timeout_ms, -2 on failure
+//or -3 once interrupted. a negative timeout_ms waits as long as it takes
+//a process counts as exited once both of its pipes hit end of file, then it gets reaped
+static int process_pool_wait(CbsProcessPool *pool,int timeout_ms,int *exit_code){
+    uint64_t deadline_ms = time_now_ms() + (uint64_t)(timeout_ms < 0 ? 0 : timeout_ms);
+    while(true){
+        for (int slot = 0; slot < pool->count; slot++) {
+            CbsProcess *process = &pool->processes[slot];
+            if(process->output_fds[0] != -1 || process->output_fds[1] != -1) continue;
+            int status = 0;
+            while(waitpid(process->pid,&status,0) == -1 && errno == EINTR){}
+            if(WIFEXITED(status)) *exit_code = WEXITSTATUS(status);
+            else *exit_code = 128 + WTERMSIG(status);
+            return slot;
         }
-        buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, compiler_flag);
-        buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE,' ');
+        if(cbs_interrupted) return -3;
+        if(pool->count == 0) return -1;
+        //output arriving doesn't restart the timeout
+        int remaining_ms = -1;
+        if(timeout_ms >= 0){
+            uint64_t now_ms = time_now_ms();
+            remaining_ms = now_ms >= deadline_ms ? 0 : (int)(deadline_ms - now_ms);
+        }
+
+#if defined(__linux__)
+        struct epoll_event events[64];
+        int event_count = epoll_wait(pool->epoll_fd,events,64,remaining_ms);
+        if(event_count == -1){
+            if(errno == EINTR) continue;
+            cbs_log_error("epoll_wait failed (%d)",errno);
+            return -2;
+        }
+        if(event_count == 0) return -1;
+        for (int i = 0; i < event_count; i++) {
+            if(events[i].data.u64 == CBS_INTERRUPT_EVENT) continue;
+            pid_t pid = (pid_t)(events[i].data.u64 >> 1);
+            int stream = (int)(events[i].data.u64 & 1);
+            for (int slot = 0; slot < pool->count; slot++) {
+                if(pool->processes[slot].pid != pid) continue;
+                if(pool->processes[slot].output_fds[stream] != -1){
+                    process_pool_drain(pool,slot,stream);
+                }
+                break;
+            }
+        }
+#else
+        int fd_count = 0;
+        for (int slot = 0; slot < pool->count; slot++) {
+            for (int stream = 0; stream < 2; stream++) {
+                if(pool->processes[slot].output_fds[stream] == -1) continue;
+                pool->poll_fds[fd_count].fd = pool->processes[slot].output_fds[stream];
+                pool->poll_fds[fd_count].events = POLLIN;
+                pool->poll_fds[fd_count].revents = 0;
+                fd_count++;
+            }
+        }
+        if(cbs_interrupt_pipe[0] != -1){
+            pool->poll_fds[fd_count].fd = cbs_interrupt_pipe[0];
+            pool->poll_fds[fd_count].events = POLLIN;
+            pool->poll_fds[fd_count].revents = 0;
+            fd_count++;
+        }
+        int ready_count = poll(pool->poll_fds,fd_count,remaining_ms);
+        if(ready_count == -1){
+            if(errno == EINTR) continue;
+            cbs_log_error("poll failed (%d)",errno);
+            return -2;
+        }
+        if(ready_count == 0) return -1;
+        int fd_index = 0;
+        for (int slot = 0; slot < pool->count; slot++) {
+            for (int stream = 0; stream < 2; stream++) {
+                if(pool->processes[slot].output_fds[stream] == -1) continue;
+                if(pool->poll_fds[fd_index++].revents != 0){
+                    process_pool_drain(pool,slot,stream);
+                }
+            }
+        }
+#endif
     }
+}
 
-    //add include paths
-    for (int i = 0; i < module.shared_include_paths.length; i++) {
-        const char* inc_path = module.shared_include_paths.items[i];
+static int processor_count(void){
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count < 1 ? 1 : (int)count;
+}
 
-        buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, "-I");
-        buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE,'"');
-        buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, inc_path);
-        buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE,'"');
-        buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE,' ');
-    }
-    for (int i = 0; i < module.unique_include_paths.length; i++) {
-        const char* inc_path = module.unique_include_paths.items[i];
+#if defined(__linux__)
+//the syscall instead of sched_setaffinity, which needs _GNU_SOURCE before the first include of the build script
+static unsigned long saved_affinity_mask[1024 / (8 * sizeof(unsigned long))];
+static bool affinity_saved = false;
 
-        buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, "-I");
-        buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE,'"');
-        buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, inc_path);
-        buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE,'"');
-        buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE,' ');
+//processes started while pinned inherit the cpu, a negative cpu restores the mask from before
+static bool pin_to_cpu(int cpu){
+    if(cpu < 0){
+        if(affinity_saved == false) return true;
+        affinity_saved = false;
+        return syscall(SYS_sched_setaffinity,0,sizeof(saved_affinity_mask),saved_affinity_mask) == 0;
     }
+    const int bits_per_word = 8 * sizeof(unsigned long);
+    if(cpu >= 1024) return false;
+    if(affinity_saved == false){
+        if(syscall(SYS_sched_getaffinity,0,sizeof(saved_affinity_mask),saved_affinity_mask) < 0) return false;
+        affinity_saved = true;
+    }
+    unsigned long mask[1024 / (8 * sizeof(unsigned long))] = {0};
+    mask[cpu / bits_per_word] = 1UL << (cpu % bits_per_word);
+    return syscall(SYS_sched_setaffinity,0,sizeof(mask),mask) == 0;
+}
+#else
+//mac has no way to pin a process to a cpu
+static bool pin_to_cpu(int cpu){
+    return cpu < 0;
+}
+#endif
 
-    //add library paths
-    for (int i = 0; i < module.shared_library_paths.length; i++) {
-        const char* library_path = module.shared_library_paths.items[i];
+static bool make_directory(const char *path){
+    return mkdir(path,0755) == 0 || errno == EEXIST;
+}
 
-        buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, "-L");
-        buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE,'"');
-        buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, library_path);
-        buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE,'"');
-        buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE,' ');
+static bool try_get_file_modified_time(const char *path,int64_t *modified_ns){
+    struct stat info;
+    if(stat(path,&info) != 0){
+        return false;
     }
-    for (int i = 0; i < module.unique_library_paths.length; i++) {
-        const char* library_path = module.unique_library_paths.items[i];
+#if defined(__APPLE__)
+    *modified_ns = (int64_t)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+    *modified_ns = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+//takes a time from try_get_file_modified_time, the access time is left alone
+static bool set_file_modified_time(const char *path,int64_t modified_ns){
+    struct timespec times[2];
+    times[0].tv_sec = 0;
+    times[0].tv_nsec = UTIME_OMIT;
+    times[1].tv_sec = (time_t)(modified_ns / 1000000000);
+    times[1].tv_nsec = (long)(modified_ns % 1000000000);
+    return utimensat(AT_FDCWD,path,times,0) == 0;
+}
 
-        buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, "-L");
-        buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE,'"');
-        buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, library_path);
-        buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE,'"');
-        buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE,' ');
+typedef struct CbsMappedFile{
+    const char *data;
+    size_t size;
+}CbsMappedFile;
+
+static bool file_map(const char *path,CbsMappedFile *mapped){
+    memset(mapped,0,sizeof(CbsMappedFile));
+    int fd = open(path,O_RDONLY | O_CLOEXEC);
+    if(fd == -1){
+        return false;
+    }
+    struct stat info;
+    if(fstat(fd,&info) != 0){
+        close(fd);
+        return false;
+    }
+    mapped->size = (size_t)info.st_size;
+    if(mapped->size > 0){
+        void *data = mmap(NULL,mapped->size,PROT_READ,MAP_PRIVATE,fd,0);
+        if(data == MAP_FAILED){
+            close(fd);
+            return false;
+        }
+        mapped->data = data;
     }
+    close(fd);
+    return true;
+}
 
-    //add linker flags
-    for (int i = 0; i < module.shared_linker_flags.length; i++) {
-        const char* linker_flag = module.shared_linker_flags.items[i];
-        if(string_starts_with(linker_flag, "-l") == false){
-            buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, "-l");
+static void file_unmap(CbsMappedFile *mapped){
+    if(mapped->data != NULL) munmap((void*)mapped->data,mapped->size);
+}
+
+static bool copy_file_bytes(int from_fd,int to_fd){
+    char buffer[65536];
+    while(true){
+        ssize_t read_count = read(from_fd,buffer,sizeof(buffer));
+        if(read_count == 0) return true;
+        if(read_count < 0){
+            if(errno == EINTR) continue;
+            return false;
+        }
+        for (ssize_t written = 0; written < read_count;) {
+            ssize_t count = write(to_fd,&buffer[written],(size_t)(read_count - written));
+            if(count < 0 && errno != EINTR) return false;
+            if(count > 0) written += count;
         }
-        buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, linker_flag);
-        buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE,' ');
     }
-    for (int i = 0; i < module.unique_linker_flags.length; i++) {
-        const char* linker_flag = module.unique_linker_flags.items[i];
-        if(string_starts_with(linker_flag, "-l") == false){
-            buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, "-l");
+}
+
+//to must not exist yet. a reflink first, then copy_file_range, then a hard link, then read and write.
+//copy_file_range and the clone go through the syscall, their wrappers need _GNU_SOURCE
+static CbsCopyMethod copy_file_fast(const char *from,const char *to){
+    struct stat info;
+    if(stat(from,&info) != 0) return CBS_COPY_FAILED;
+#if defined(__APPLE__)
+    if(clonefile(from,to,0) == 0) return CBS_COPY_CLONE;
+#endif
+    int from_fd = open(from,O_RDONLY | O_CLOEXEC);
+    if(from_fd == -1) return CBS_COPY_FAILED;
+    int to_fd = open(to,O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,info.st_mode & 0777);
+    if(to_fd == -1){
+        close(from_fd);
+        return CBS_COPY_FAILED;
+    }
+
+    CbsCopyMethod method = CBS_COPY_FAILED;
+    off_t copied = 0;
+#if defined(__linux__)
+    if(ioctl(to_fd,FICLONE,from_fd) == 0) method = CBS_COPY_CLONE;
+#ifdef SYS_copy_file_range
+    while(method == CBS_COPY_FAILED && copied < info.st_size){
+        ssize_t count = syscall(SYS_copy_file_range,from_fd,NULL,to_fd,NULL,(size_t)(info.st_size - copied),0);
+        if(count <= 0) break;
+        copied += count;
+    }
+    if(method == CBS_COPY_FAILED && copied > 0 && copied == info.st_size) method = CBS_COPY_KERNEL;
+#endif
+#endif
+    if(method == CBS_COPY_FAILED && copied == 0 && info.st_size > 0){
+        close(to_fd);
+        remove(to);
+        if(link(from,to) == 0){
+            close(from_fd);
+            return CBS_COPY_HARDLINK;
         }
-        buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, linker_flag);
-        buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE,' ');
+        to_fd = open(to,O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,info.st_mode & 0777);
     }
+    //whatever copy_file_range got across stays, the file offsets of both continue after it
+    if(method == CBS_COPY_FAILED && to_fd != -1 && copy_file_bytes(from_fd,to_fd)) method = CBS_COPY_BYTES;
+    close(from_fd);
+    if(to_fd != -1) close(to_fd);
+    if(method == CBS_COPY_FAILED) remove(to);
+    return method;
+}
 
-    //add source files
-    char search_path[FILE_PATH_MAX];
+//true when both paths are hard links to one file
+static bool files_are_same(const char *a,const char *b){
+    struct stat info_a;
+    struct stat info_b;
+    if(stat(a,&info_a) != 0 || stat(b,&info_b) != 0) return false;
+    return info_a.st_dev == info_b.st_dev && info_a.st_ino == info_b.st_ino;
+}
 
-    if(try_get_program_path(search_path)==false){
-        cbs_log_error("failed to get executable path");
-        return;
+//kills the whole process group, it still has to be collected with process_pool_wait.
+//its pipes are closed right away in case something outside the group keeps them open
+static void process_pool_kill(CbsProcessPool *pool,int slot){
+    CbsProcess *process = &pool->processes[slot];
+    if(kill(-process->pid,SIGKILL) != 0) kill(process->pid,SIGKILL);
+    for (int stream = 0; stream < 2; stream++) {
+        if(process->output_fds[stream] == -1) continue;
+#if defined(__linux__)
+        epoll_ctl(pool->epoll_fd,EPOLL_CTL_DEL,process->output_fds[stream],NULL);
+#endif
+        close(process->output_fds[stream]);
+        process->output_fds[stream] = -1;
     }
+}
 
-    if(string_is_null_empty_or_whitespace(module.source_file_directory) == false){
-        buffer_append_string(search_path,FILE_PATH_MAX, module.source_file_directory);
-        size_t src_file_dir_len = strlen(module.source_file_directory);
-        if(module.source_file_directory[src_file_dir_len-1] != FILE_SEPARATOR){
-            buffer_append_char(search_path,FILE_PATH_MAX,FILE_SEPARATOR);
-        }
+//kills every process and waits until they're gone, their output is thrown away
+static void process_pool_cancel(CbsProcessPool *pool){
+    for (int slot = 0; slot < pool->count; slot++) {
+        process_pool_kill(pool,slot);
     }
+    for (int slot = 0; slot < pool->count; slot++) {
+        int status = 0;
+        while(waitpid(pool->processes[slot].pid,&status,0) == -1 && errno == EINTR){}
+        free(pool->outputs[slot].items);
+        memset(&pool->outputs[slot],0,sizeof(CbsStringBuilder));
+    }
+    pool->count = 0;
+}
+#endif
 
-    add_files_recursive_from_source_directory(search_path,command_buffer,module.source_files_to_exclude);
-    
-    for(int i = 0; i<module.additional_source_file_paths.length; i++){
-        const char* additional_src_file_path = module.additional_source_file_paths.items[i];
-        buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, additional_src_file_path);
-        buffer_append_char(command_buffer, COMMAND_BUFFER_SIZE, ' ');
+//search_path must end with a separator
+static void add_files_recursive_from_source_directory(char* search_path, CbsStringList *source_files,const CbsSourceMatcher *matcher){
+    CbsStringList pending_directories = {0};
+    string_list_add(&pending_directories,search_path);
+    char directory[FILE_PATH_MAX];
+    while(pending_directories.length > 0){
+        char *next = pending_directories.items[--pending_directories.length];
+        snprintf(directory,FILE_PATH_MAX,"%s",next);
+        free(next);
+        add_files_from_source_directory(directory,source_files,&pending_directories,matcher);
     }
+    string_list_free(&pending_directories);
+}
+
+#ifdef _WIN32
+//lists the same sources a build compiles, found with the source matcher of each module
+void create_compile_commands_json(const CbsModule *module_array,const int array_length){
+
+    char path_buffer[FILE_PATH_MAX];
+    DWORD bytes = GetCurrentDirectoryA(FILE_PATH_MAX, path_buffer);
+    path_buffer[bytes+1] = '\0';
+
+    const char* cc = "compile_commands.json";
+    buffer_append_char(path_buffer,FILE_PATH_MAX,FILE_SEPARATOR);
+    buffer_append_string(path_buffer, FILE_PATH_MAX,cc);
 
-    // add output
-    buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, "-o ");
-    buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, module.output_directory);
-    size_t output_directory_length = strlen(module.output_directory);
-    if(module.output_directory[output_directory_length-1] != FILE_SEPARATOR){
-        buffer_append_char(command_buffer,COMMAND_BUFFER_SIZE,FILE_SEPARATOR);
+    HANDLE file = CreateFileA(
+        path_buffer,
+        GENERIC_READ | GENERIC_WRITE,
+        0,
+        NULL,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if(file == INVALID_HANDLE_VALUE){
+        fprintf(stderr,"couldn't create file at [%s]\n",path_buffer);
+        return;
     }
-    buffer_append_string(command_buffer, COMMAND_BUFFER_SIZE, module.output_file_name_with_extension);
+    WriteFile(file,"[\n",2,NULL,NULL);
 
-    run_command_line(command_buffer);
+    //patterns are relative to the folder of the build script, like in a build
+    char program_path[FILE_PATH_MAX];
+    if(try_get_program_path(program_path) == false){
+        fprintf(stderr,"failed to get executable path\n");
+        CloseHandle(file);
+        return;
+    }
+    bool first_block = true;
+    for(int i = 0; i < array_length; i++){
+        CbsModule module = module_array[i];
+        char search_path[FILE_PATH_MAX];
+        snprintf(search_path,FILE_PATH_MAX,"%s",program_path);
+        if(module.source_file_directory != NULL){
+            buffer_append_string(search_path, FILE_PATH_MAX, module.source_file_directory);
+            if(string_ends_with_char(module.source_file_directory,FILE_SEPARATOR)==false){
+                buffer_append_char(search_path, FILE_PATH_MAX, FILE_SEPARATOR);
+            }
+        }
+        CbsSourceMatcher matcher;
+        source_matcher_init(&matcher,&module,strlen(program_path));
+        CbsStringList source_files = {0};
+        add_files_recursive_from_source_directory(search_path,&source_files,&matcher);
+        qsort(source_files.items,source_files.length,sizeof(char*),compare_strings);
+        for (int f = 0; f < source_files.length; f++) {
+            add_file_to_compile_commands(file,source_files.items[f],module,&first_block);
+        }
+        string_list_free(&source_files);
+        source_matcher_free(&matcher);
+    }
+    WriteFile(file,"\n]\n",3,NULL,NULL);
+
+    CloseHandle(file);
+}
+#endif
+
+//hands the captured output of the slot to the caller, the last slot moves into its place
+static CbsStringBuilder process_pool_remove(CbsProcessPool *pool,int slot){
+    CbsStringBuilder output = pool->outputs[slot];
+    pool->count--;
+    pool->processes[slot] = pool->processes[pool->count];
+    pool->outputs[slot] = pool->outputs[pool->count];
+    memset(&pool->outputs[pool->count],0,sizeof(CbsStringBuilder));
+    return output;
+}
+
+static bool directory_exists(const char *path){
+    struct stat info;
+    if(stat(path,&info) != 0){
+        return false;
+    }
+    return (info.st_mode & S_IFDIR) != 0;
+}
+
+static uint64_t get_file_size(const char *path){
+    struct stat info;
+    if(stat(path,&info) != 0){
+        return 0;
+    }
+    return (uint64_t)info.st_size;
+}
+
+//creates every missing directory leading up to the file
+static bool make_directories_for_file(const char *file_path){
+    char path[FILE_PATH_MAX];
+    snprintf(path,FILE_PATH_MAX,"%s",file_path);
+    for (size_t i = 1; path[i] != '\0'; i++) {
+        if(path[i] != FILE_SEPARATOR && path[i] != '/') continue;
+        char separator = path[i];
+        path[i] = '\0';
+        if(directory_exists(path) == false && make_directory(path) == false){
+            cbs_log_error("couldn't create directory [%s]",path);
+            return false;
+        }
+        path[i] = separator;
+    }
+    return true;
+}
+
+//the program as given if it names a folder, otherwise the first match on PATH
+static bool resolve_program_path(const char *program,char *path_buffer){
+    struct stat info;
+    if(strchr(program,'/') != NULL || strchr(program,FILE_SEPARATOR) != NULL){
+        snprintf(path_buffer,FILE_PATH_MAX,"%s",program);
+        return stat(path_buffer,&info) == 0 && (info.st_mode & S_IFREG) != 0;
+    }
+    const char *search_paths = getenv("PATH");
+    if(search_paths == NULL) return false;
+#ifdef _WIN32
+    const char list_separator = ';';
+    const char *suffix = string_ends_with_string(program,".exe") ? "" : ".exe";
+#else
+    const char list_separator = ':';
+    const char *suffix = "";
+#endif
+    while(true){
+        const char *end = strchr(search_paths,list_separator);
+        int length = end == NULL ? (int)strlen(search_paths) : (int)(end - search_paths);
+        if(length > 0){
+            snprintf(path_buffer,FILE_PATH_MAX,"%.*s%c%s%s",length,search_paths,FILE_SEPARATOR,program,suffix);
+            if(stat(path_buffer,&info) == 0 && (info.st_mode & S_IFREG) != 0){
+#ifndef _WIN32
+                if(access(path_buffer,X_OK) == 0)
+#endif
+                return true;
+            }
+        }
+        if(end == NULL) return false;
+        search_paths = end + 1;
+    }
+}
+
+//PATH is only walked once per program. an empty string remembers a program that isn't there
+static CbsMap resolved_programs = {0};
+
+static const char* find_program(const char *program){
+    const char *cached = map_get(&resolved_programs,program);
+    if(cached == NULL){
+        char path[FILE_PATH_MAX];
+        cached = string_duplicate(resolve_program_path(program,path) ? path : "");
+        map_put(&resolved_programs,program,(void*)cached);
+    }
+    return cached[0] == '\0' ? NULL : cached;
+}
+
+//the resolved path so jobs don't search PATH again. a path is kept as written, and so is
+//a compiler that can't be resolved like "ccache gcc"
+static void builder_append_program(CbsStringBuilder *builder,const char *program){
+    const char *path = find_program(program);
+    if(path != NULL && strcmp(path,program) != 0){
+        builder_append_quoted(builder,path);
+        return;
+    }
+    builder_append_string(builder,program);
+    builder_append_char(builder,' ');
+}
+
+// ==========================================
+// ============ BUILD RECORDS ===============
+// ==========================================
+
+#define CBS_RECORDS_VERSION "cbs-records 3"
+
+//per output facts remembered between runs, stored in .cbs/records
+typedef struct CbsRecord{
+    uint64_t duration_ms;
+    uint64_t command_hash;
+    //hash of the output content, 0 when unknown
+    uint64_t output_hash;
+    //when the job last ran, inputs older than this are up to date even if the output kept an older time
+    int64_t restat_ns;
+}CbsRecord;
+
+static CbsRecord* record_get_or_create(CbsMap *records,const char *key){
+    CbsRecord *record = map_get(records,key);
+    if(record == NULL){
+        record = calloc(1,sizeof(CbsRecord));
+        map_put(records,key,record);
+    }
+    return record;
+}
+
+static void records_load(CbsMap *records,const char *path){
+    FILE *file = fopen(path,"r");
+    if(file == NULL) return;
+
+    //records from another version are dropped, everything just rebuilds once
+    char line[FILE_PATH_MAX + 64];
+    if(fgets(line,sizeof(line),file) == NULL || string_starts_with(line,CBS_RECORDS_VERSION) == false){
+        fclose(file);
+        return;
+    }
+    while(fgets(line,sizeof(line),file) != NULL){
+        unsigned long long duration_ms = 0;
+        unsigned long long command_hash = 0;
+        unsigned long long output_hash = 0;
+        long long restat_ns = 0;
+        int key_offset = 0;
+        if(sscanf(line,"%llu %llx %llx %lld %n",&duration_ms,&command_hash,&output_hash,&restat_ns,&key_offset) != 4 || key_offset == 0){
+            continue;
+        }
+        char *key = &line[key_offset];
+        key[strcspn(key,"\r\n")] = '\0';
+        if(key[0] == '\0') continue;
+        CbsRecord *record = record_get_or_create(records,key);
+        record->duration_ms = duration_ms;
+        record->command_hash = command_hash;
+        record->output_hash = output_hash;
+        record->restat_ns = restat_ns;
+    }
+    fclose(file);
+}
+
+static void records_save(const CbsMap *records,const char *path){
+    char temporary_path[FILE_PATH_MAX];
+    snprintf(temporary_path,FILE_PATH_MAX,"%s.tmp",path);
+    FILE *file = fopen(temporary_path,"w");
+    if(file == NULL){
+        cbs_log_error("couldn't write build records to [%s]",temporary_path);
+        return;
+    }
+    fprintf(file,"%s\n",CBS_RECORDS_VERSION);
+    for (uint32_t i = 0; i < records->capacity; i++) {
+        const CbsMapEntry *entry = &records->entries[i];
+        if(entry->key == NULL) continue;
+        const CbsRecord *record = entry->value;
+        fprintf(file,"%llu %llx %llx %lld %s\n",
+            (unsigned long long)record->duration_ms,
+            (unsigned long long)record->command_hash,
+            (unsigned long long)record->output_hash,
+            (long long)record->restat_ns,
+            entry->key
+        );
+    }
+    fclose(file);
+    remove(path);
+    if(rename(temporary_path,path) != 0){
+        cbs_log_error("couldn't replace build records at [%s]",path);
+    }
+}
+
+// ==========================================
+// ============ BUILD GRAPH =================
+// ==========================================
+
+typedef struct CbsOptions{
+    int job_count;
+    //file with one changed path per line, "-" reads stdin
+    const char *changed_from;
+    bool dry_run;
+    //name of the configuration to build, NULL picks the first one
+    const char *configuration;
+    //--shard=i/N runs the ith of N parts of the tests, i counts from 1. shard_count is 0 without it
+    int shard_index;
+    int shard_count;
+    //after a failure, -k keeps starting every job that doesn't depend on it,
+    //--fail-fast kills the running ones too. by default running jobs finish and nothing new starts
+    bool keep_going;
+    bool fail_fast;
+    //bench-run: measured and warm-up runs of every benchmark, the cpu they're pinned to with --cpu=N
+    int benchmark_runs;
+    int benchmark_warmup_runs;
+    bool warmup_runs_given;
+    int benchmark_cpu;
+    bool pin_benchmarks;
+    //file the medians are compared against, NULL for .cbs/bench-baseline
+    const char *baseline_path;
+    bool update_baseline;
+    //where cbs_modules_install puts the files, NULL for the "install" folder next to the build script
+    const char *install_prefix;
+}CbsOptions;
+
+static CbsOptions cbs_options = {0};
+
+//set by cbs_set_configurations, every build picks one of them
+static const CbsConfiguration *cbs_configurations = NULL;
+static int cbs_configuration_count = 0;
+
+typedef enum CbsJobKind{
+    CBS_JOB_COMPILE,
+    CBS_JOB_LINK,
+    //packs the split debug info of a link into a .dwp
+    CBS_JOB_PACKAGE,
+    //a CbsStep, output_path is its first output
+    CBS_JOB_STEP
+}CbsJobKind;
+
+typedef enum CbsJobState{
+    CBS_JOB_WAITING,
+    CBS_JOB_READY,
+    CBS_JOB_RUNNING,
+    CBS_JOB_SUCCEEDED,
+    //ran, but wrote the same output as last time, so nothing after it has to
+    CBS_JOB_UNCHANGED,
+    CBS_JOB_UP_TO_DATE,
+    CBS_JOB_FAILED,
+    CBS_JOB_SKIPPED
+}CbsJobState;
+
+typedef struct CbsJob{
+    CbsJobKind kind;
+    CbsJobState state;
+    int module_index;
+    char *command_line;
+    //appended when the job starts but not part of the command hash, NULL for none
+    char *launch_flags;
+    char *display_name;
+    char *input_path;
+    char *output_path;
+    char *depfile_path;
+    //split debug info written by the compile, NULL without split_dwarf
+    char *dwo_path;
+    //NULL unless the job is a step, previous_outputs_ns has the time of each of its outputs before it ran
+    const CbsStep *step;
+    int64_t *previous_outputs_ns;
+    int *dependents;
+    int dependents_length;
+    int dependents_capacity;
+    int *dependencies;
+    int dependencies_length;
+    int dependencies_capacity;
+    int pending_dependencies;
+    uint64_t estimated_ms;
+    //estimated time from starting this job to the end of the longest chain of jobs waiting on it
+    uint64_t priority;
+    bool priority_computed;
+    uint64_t start_ms;
+    //time of the output before the job ran, 0 when there was none
+    int64_t previous_output_ns;
+    //with --changed-from, only selected jobs run
+    bool selected;
+    //compiles that can share a compiler process with others of their module, see build_gather_batch
+    bool batchable;
+    //next job in the same compiler process, -1 for the last one
+    int batch_next;
+}CbsJob;
+
+//the same modules built another way, a named mode keeps its objects and records in .cbs/<name>/
+typedef struct CbsBuildMode{
+    const char *name;
+    //added to every compile and link
+    const char *compiler_flags;
+    //added to every link after the linker flags of the module
+    const char *linker_flags;
+    //absolute, NULL keeps the output directory of each module
+    const char *output_directory;
+    //folder inside the output directory of each module, NULL for none
+    const char *output_subdirectory;
+    //every compile is out of date once this file is newer than its object
+    const char *input_path;
+}CbsBuildMode;
+
+//source discovery of one module. its compiles are added a folder at a time, so they can already run
+//while later folders are still being read. the link waits until the scan is finished
+typedef struct CbsModuleScan{
+    CbsSourceMatcher matcher;
+    CbsStringList pending_directories;
+    char source_root[FILE_PATH_MAX];
+    int source_count;
+    //a source got no compile, so the module can't link
+    bool source_failed;
+    bool finished;
+}CbsModuleScan;
+
+typedef struct CbsBuild{
+    CbsBuildMode mode;
+    const CbsModule *modules;
+    int module_count;
+    int *link_jobs;
+    CbsJob *jobs;
+    int job_count;
+    int job_capacity;
+    //max heap of job indices ordered by priority
+    int *ready;
+    int ready_length;
+    int ready_capacity;
+    CbsMap records;
+    //sources and headers seen this build, shared by every module
+    CbsMap scanned_files;
+    CbsMap resolved_includes;
+    uint32_t visit_generation;
+    //compiler and flags of each module for batched compiles, NULL when the module doesn't batch
+    char **batch_prefixes;
+    //step name -> job index + 1, a step listed by several modules runs once
+    CbsMap step_jobs;
+    CbsModuleScan *scans;
+    //modules are scanned one after the other, all before this one are finished
+    int scanning_module;
+    bool scan_failed;
+    //once jobs run, new compiles go straight into the ready heap
+    bool started;
+    char program_path[FILE_PATH_MAX];
+    char state_path[FILE_PATH_MAX];
+    //objects and records of the mode, the same as state_path for the normal build
+    char mode_path[FILE_PATH_MAX];
+    //what the mode of the selected configuration points to
+    char configuration_mode_name[FILE_PATH_MAX];
+    CbsStringBuilder configuration_compiler_flags;
+    CbsStringBuilder configuration_linker_flags;
+    int failed_count;
+    int ran_count;
+    int unchanged_count;
+}CbsBuild;
+
+void cbs_parse_options(const int argc, const char **argv){
+    for (int i = 2; i < argc; i++) {
+        const char *arg = argv[i];
+        //everything after -- belongs to another program, e.g. the training command of pgo
+        if(strcmp(arg,"--") == 0) break;
+        if(strcmp(arg,"-j") == 0 && i + 1 < argc){
+            cbs_options.job_count = atoi(argv[++i]);
+        }else if(string_starts_with(arg,"--jobs=")){
+            cbs_options.job_count = atoi(&arg[strlen("--jobs=")]);
+        }else if(string_starts_with(arg,"-j")){
+            cbs_options.job_count = atoi(&arg[2]);
+        }else if(strcmp(arg,"--changed-from") == 0 && i + 1 < argc){
+            cbs_options.changed_from = argv[++i];
+        }else if(string_starts_with(arg,"--changed-from=")){
+            cbs_options.changed_from = &arg[strlen("--changed-from=")];
+        }else if(strcmp(arg,"--dry-run") == 0){
+            cbs_options.dry_run = true;
+        }else if(strcmp(arg,"--config") == 0 && i + 1 < argc){
+            cbs_options.configuration = argv[++i];
+        }else if(string_starts_with(arg,"--config=")){
+            cbs_options.configuration = &arg[strlen("--config=")];
+        }else if(strcmp(arg,"-k") == 0 || strcmp(arg,"--keep-going") == 0){
+            cbs_options.keep_going = true;
+        }else if(strcmp(arg,"--fail-fast") == 0){
+            cbs_options.fail_fast = true;
+        }else if(string_starts_with(arg,"--runs=")){
+            cbs_options.benchmark_runs = atoi(&arg[strlen("--runs=")]);
+        }else if(string_starts_with(arg,"--warmup=")){
+            cbs_options.benchmark_warmup_runs = atoi(&arg[strlen("--warmup=")]);
+            cbs_options.warmup_runs_given = true;
+        }else if(string_starts_with(arg,"--cpu=")){
+            cbs_options.benchmark_cpu = atoi(&arg[strlen("--cpu=")]);
+            cbs_options.pin_benchmarks = true;
+        }else if(strcmp(arg,"--baseline") == 0 && i + 1 < argc){
+            cbs_options.baseline_path = argv[++i];
+        }else if(string_starts_with(arg,"--baseline=")){
+            cbs_options.baseline_path = &arg[strlen("--baseline=")];
+        }else if(strcmp(arg,"--update-baseline") == 0){
+            cbs_options.update_baseline = true;
+        }else if(strcmp(arg,"--prefix") == 0 && i + 1 < argc){
+            cbs_options.install_prefix = argv[++i];
+        }else if(string_starts_with(arg,"--prefix=")){
+            cbs_options.install_prefix = &arg[strlen("--prefix=")];
+        }else if(string_starts_with(arg,"--shard=")){
+            if(sscanf(&arg[strlen("--shard=")],"%d/%d",&cbs_options.shard_index,&cbs_options.shard_count) != 2 || cbs_options.shard_count < 1){
+                cbs_log_error("expected --shard=i/N, got [%s]",arg);
+                cbs_options.shard_index = 0;
+                cbs_options.shard_count = 1;
+            }
+        }
+    }
+}
+
+//the configurations every build, test, bench, install and ninja export picks from with --config=<name>,
+//the first one without it. the array has to outlive the builds
+void cbs_set_configurations(const CbsConfiguration *configuration_array,const int configuration_count){
+    cbs_configurations = configuration_array;
+    cbs_configuration_count = configuration_count;
+}
+
+static int build_add_job(CbsBuild *build,CbsJobKind kind,int module_index){
+    if(build->job_count == build->job_capacity){
+        build->job_capacity = build->job_capacity == 0 ? 64 : build->job_capacity * 2;
+        build->jobs = realloc(build->jobs,sizeof(CbsJob) * build->job_capacity);
+    }
+    CbsJob *job = &build->jobs[build->job_count];
+    memset(job,0,sizeof(CbsJob));
+    job->kind = kind;
+    job->module_index = module_index;
+    job->batch_next = -1;
+    return build->job_count++;
+}
+
+//job_index can't start until dependency_index has succeeded
+static void build_add_dependency(CbsBuild *build,int job_index,int dependency_index){
+    CbsJob *dependency = &build->jobs[dependency_index];
+    if(dependency->dependents_length == dependency->dependents_capacity){
+        dependency->dependents_capacity = dependency->dependents_capacity == 0 ? 4 : dependency->dependents_capacity * 2;
+        dependency->dependents = realloc(dependency->dependents,sizeof(int) * dependency->dependents_capacity);
+    }
+    dependency->dependents[dependency->dependents_length++] = job_index;
+
+    CbsJob *job = &build->jobs[job_index];
+    if(job->dependencies_length == job->dependencies_capacity){
+        job->dependencies_capacity = job->dependencies_capacity == 0 ? 4 : job->dependencies_capacity * 2;
+        job->dependencies = realloc(job->dependencies,sizeof(int) * job->dependencies_capacity);
+    }
+    job->dependencies[job->dependencies_length++] = dependency_index;
+    job->pending_dependencies++;
+}
+
+static bool job_runs_before(const CbsBuild *build,int a,int b){
+    const CbsJob *job_a = &build->jobs[a];
+    const CbsJob *job_b = &build->jobs[b];
+    if(job_a->priority != job_b->priority) return job_a->priority > job_b->priority;
+    return a < b;
+}
+
+static void build_push_ready(CbsBuild *build,int job_index){
+    if(build->ready_length == build->ready_capacity){
+        build->ready_capacity = build->ready_capacity == 0 ? 64 : build->ready_capacity * 2;
+        build->ready = realloc(build->ready,sizeof(int) * build->ready_capacity);
+    }
+    build->jobs[job_index].state = CBS_JOB_READY;
+    int index = build->ready_length++;
+    build->ready[index] = job_index;
+    while(index > 0){
+        int parent = (index - 1) / 2;
+        if(job_runs_before(build,build->ready[parent],build->ready[index])) break;
+        int swap = build->ready[parent];
+        build->ready[parent] = build->ready[index];
+        build->ready[index] = swap;
+        index = parent;
+    }
+}
+
+static int build_pop_ready(CbsBuild *build){
+    int top = build->ready[0];
+    build->ready[0] = build->ready[--build->ready_length];
+    int index = 0;
+    while(true){
+        int best = index;
+        int left = index * 2 + 1;
+        int right = left + 1;
+        if(left < build->ready_length && job_runs_before(build,build->ready[left],build->ready[best])) best = left;
+        if(right < build->ready_length && job_runs_before(build,build->ready[right],build->ready[best])) best = right;
+        if(best == index) break;
+        int swap = build->ready[best];
+        build->ready[best] = build->ready[index];
+        build->ready[index] = swap;
+        index = best;
+    }
+    return top;
+}
+
+static uint64_t build_compute_priority(CbsBuild *build,int job_index){
+    CbsJob *job = &build->jobs[job_index];
+    if(job->priority_computed) return job->priority;
+
+    uint64_t longest_remaining = 0;
+    for (int i = 0; i < job->dependents_length; i++) {
+        uint64_t remaining = build_compute_priority(build,job->dependents[i]);
+        if(remaining > longest_remaining) longest_remaining = remaining;
+    }
+    job->priority = job->estimated_ms + longest_remaining;
+    job->priority_computed = true;
+    return job->priority;
+}
+
+static void build_skip_job(CbsBuild *build,int job_index){
+    CbsJob *job = &build->jobs[job_index];
+    if(job->state != CBS_JOB_WAITING) return;
+    job->state = CBS_JOB_SKIPPED;
+    for (int i = 0; i < job->dependents_length; i++) {
+        build_skip_job(build,job->dependents[i]);
+    }
+}
+
+static void build_finish_job(CbsBuild *build,int job_index,CbsJobState state){
+    CbsJob *job = &build->jobs[job_index];
+    bool succeeded = state == CBS_JOB_SUCCEEDED || state == CBS_JOB_UNCHANGED || state == CBS_JOB_UP_TO_DATE;
+    job->state = state;
+    if(succeeded == false){
+        build->failed_count++;
+    }
+    for (int i = 0; i < job->dependents_length; i++) {
+        int dependent_index = job->dependents[i];
+        CbsJob *dependent = &build->jobs[dependent_index];
+        if(succeeded == false){
+            build_skip_job(build,dependent_index);
+        }else if(--dependent->pending_dependencies == 0 && dependent->state == CBS_JOB_WAITING){
+            build_push_ready(build,dependent_index);
+        }
+    }
+}
+
+// ==========================================
+// ============ INCLUDE SCANNING ============
+// ==========================================
+
+//a source or header, looked at no more than once per build however many files include it
+typedef struct CbsScannedFile{
+    bool exists;
+    int64_t modified_ns;
+    bool includes_scanned;
+    CbsStringList quoted_includes;
+    CbsStringList angled_includes;
+    uint32_t visit_generation;
+}CbsScannedFile;
+
+static CbsScannedFile* build_get_scanned_file(CbsBuild *build,const char *path){
+    CbsScannedFile *file = map_get(&build->scanned_files,path);
+    if(file == NULL){
+        file = calloc(1,sizeof(CbsScannedFile));
+        file->exists = try_get_file_modified_time(path,&file->modified_ns);
+        map_put(&build->scanned_files,path,file);
+    }
+    return file;
+}
+
+//not a preprocessor, every '#' found with memchr that is followed by include "x" or <x> counts
+//includes inside comments or #if 0 are kept too, which only ever causes an extra rebuild
+static void scan_includes(const char *data,size_t size,CbsScannedFile *file){
+    const char *end = data + size;
+    const char *cursor = data;
+    while(cursor < end){
+        const char *hash = memchr(cursor,'#',(size_t)(end - cursor));
+        if(hash == NULL) break;
+        cursor = hash + 1;
+        while(cursor < end && (*cursor == ' ' || *cursor == '\t')) cursor++;
+        if(end - cursor < 7 || memcmp(cursor,"include",7) != 0) continue;
+        cursor += 7;
+        while(cursor < end && (*cursor == ' ' || *cursor == '\t')) cursor++;
+        if(cursor >= end || (*cursor != '"' && *cursor != '<')) continue;
+
+        char close = *cursor == '"' ? '"' : '>';
+        const char *name_start = ++cursor;
+        while(cursor < end && *cursor != close && *cursor != '\n') cursor++;
+        if(cursor >= end || *cursor != close) continue;
+
+        size_t name_length = (size_t)(cursor - name_start);
+        if(name_length == 0 || name_length >= FILE_PATH_MAX) continue;
+        char name[FILE_PATH_MAX];
+        memcpy(name,name_start,name_length);
+        name[name_length] = '\0';
+        string_list_add(close == '"' ? &file->quoted_includes : &file->angled_includes,name);
+    }
+}
+
+static void scanned_file_read_includes(CbsScannedFile *file,const char *path){
+    if(file->includes_scanned) return;
+    file->includes_scanned = true;
+    CbsMappedFile mapped;
+    if(file_map(path,&mapped)){
+        scan_includes(mapped.data,mapped.size,file);
+        file_unmap(&mapped);
+    }
+}
+
+static bool path_is_absolute(const char *path){
+    if(path[0] == '/' || path[0] == '\\') return true;
+    return path[0] != '\0' && path[1] == ':';
+}
+
+static bool is_path_separator(char c){
+    return c == '/' || c == FILE_SEPARATOR;
+}
+
+static const char* path_filename(const char *path){
+    const char *filename = path;
+    for (const char *c = path; *c != '\0'; c++) {
+        if(is_path_separator(*c)) filename = c + 1;
+    }
+    return filename;
+}
+
+static bool paths_share_directory(const char *a,const char *b){
+    size_t a_length = (size_t)(path_filename(a) - a);
+    size_t b_length = (size_t)(path_filename(b) - b);
+    return a_length == b_length && strncmp(a,b,a_length) == 0;
+}
+
+//absolute version of the path with "." and ".." folders removed, relative paths start at root
+static void normalize_path(const char *root,const char *path,char *buffer){
+    char joined[FILE_PATH_MAX];
+    snprintf(joined,FILE_PATH_MAX,"%s%s",path_is_absolute(path) ? "" : root,path);
+
+    size_t root_length = joined[0] != '\0' && joined[1] == ':' ? 2 : 0;
+    memcpy(buffer,joined,root_length);
+    size_t length = root_length;
+    size_t i = root_length;
+    while(joined[i] != '\0'){
+        while(is_path_separator(joined[i])) i++;
+        size_t start = i;
+        while(joined[i] != '\0' && is_path_separator(joined[i]) == false) i++;
+        size_t segment_length = i - start;
+        if(segment_length == 0) break;
+        if(segment_length == 1 && joined[start] == '.') continue;
+        if(segment_length == 2 && joined[start] == '.' && joined[start + 1] == '.'){
+            while(length > root_length && buffer[length - 1] != FILE_SEPARATOR) length--;
+            if(length > root_length) length--;
+            continue;
+        }
+        if(length + segment_length + 2 > FILE_PATH_MAX) break;
+        buffer[length++] = FILE_SEPARATOR;
+        memcpy(&buffer[length],&joined[start],segment_length);
+        length += segment_length;
+    }
+    if(length == root_length) buffer[length++] = FILE_SEPARATOR;
+    buffer[length] = '\0';
+}
+
+//finds the header the compiler would most likely pick, "" includes look next to the includer first
+//headers that aren't found (system headers) aren't tracked
+static const char* build_resolve_include(CbsBuild *build,int module_index,const char *includer_path,const char *name,bool quoted){
+    char includer_directory[FILE_PATH_MAX];
+    includer_directory[0] = '\0';
+    if(quoted){
+        snprintf(includer_directory,FILE_PATH_MAX,"%s",includer_path);
+        remove_filename_from_path(includer_directory,strlen(includer_directory));
+    }
+
+    char key[FILE_PATH_MAX * 2];
+    snprintf(key,sizeof(key),"%d|%s|%s",module_index,includer_directory,name);
+    const char *resolved = map_get(&build->resolved_includes,key);
+    if(resolved != NULL) return resolved[0] == '\0' ? NULL : resolved;
+
+    char candidate[FILE_PATH_MAX];
+    resolved = "";
+    if(quoted){
+        snprintf(candidate,FILE_PATH_MAX,"%s%s",includer_directory,name);
+        if(build_get_scanned_file(build,candidate)->exists) resolved = candidate;
+    }
+
+    const CbsModule *module = &build->modules[module_index];
+    const CbsStringArray path_arrays[] = {module->shared_include_paths,module->unique_include_paths};
+    for (int a = 0; a < 2 && resolved[0] == '\0'; a++) {
+        for (int i = 0; i < path_arrays[a].length; i++) {
+            const char *include_path = path_arrays[a].items[i];
+            snprintf(candidate,FILE_PATH_MAX,"%s%s",path_is_absolute(include_path) ? "" : build->program_path,include_path);
+            if(string_ends_with_char(candidate,FILE_SEPARATOR) == false && string_ends_with_char(candidate,'/') == false){
+                buffer_append_char(candidate,FILE_PATH_MAX,FILE_SEPARATOR);
+            }
+            buffer_append_string(candidate,FILE_PATH_MAX,name);
+            if(build_get_scanned_file(build,candidate)->exists){
+                resolved = candidate;
+                break;
+            }
+        }
+    }
+
+    char *stored = string_duplicate(resolved);
+    map_put(&build->resolved_includes,key,stored);
+    return stored[0] == '\0' ? NULL : stored;
+}
+
+//true when the file or anything it includes, directly or not, changed after the object was written
+static bool build_includes_newer_than(CbsBuild *build,int module_index,const char *path,int64_t object_ns){
+    CbsScannedFile *file = build_get_scanned_file(build,path);
+    if(file->exists == false || file->modified_ns > object_ns) return true;
+    if(file->visit_generation == build->visit_generation) return false;
+    file->visit_generation = build->visit_generation;
+    scanned_file_read_includes(file,path);
+
+    for (int q = 0; q < 2; q++) {
+        const CbsStringList *includes = q == 0 ? &file->quoted_includes : &file->angled_includes;
+        for (int i = 0; i < includes->length; i++) {
+            const char *header = build_resolve_include(build,module_index,path,includes->items[i],q == 0);
+            if(header == NULL) continue;
+            //the list may have grown, the file pointer stays valid since values are heap allocated
+            if(build_includes_newer_than(build,module_index,header,object_ns)) return true;
+        }
+    }
+    return false;
+}
+
+//adds the file and everything it includes, directly or not
+static void build_collect_includes(CbsBuild *build,int module_index,const char *path,CbsStringList *collected){
+    CbsScannedFile *file = build_get_scanned_file(build,path);
+    if(file->exists == false || file->visit_generation == build->visit_generation) return;
+    file->visit_generation = build->visit_generation;
+    scanned_file_read_includes(file,path);
+    string_list_add(collected,path);
+
+    for (int q = 0; q < 2; q++) {
+        const CbsStringList *includes = q == 0 ? &file->quoted_includes : &file->angled_includes;
+        for (int i = 0; i < includes->length; i++) {
+            const char *header = build_resolve_include(build,module_index,path,includes->items[i],q == 0);
+            if(header != NULL) build_collect_includes(build,module_index,header,collected);
+        }
+    }
+}
+
+//reads the make style "target: dependency dependency \" file written by -MMD
+static bool read_depfile(const char *path,CbsStringList *dependencies){
+    CbsMappedFile mapped;
+    if(file_map(path,&mapped) == false) return false;
+
+    const char *data = mapped.data;
+    size_t index = 0;
+    //skip the target, a ':' followed by a separator (not a drive letter) ends it
+    while(index < mapped.size){
+        if(data[index] == ':' && (index + 1 == mapped.size || isspace((unsigned char)data[index + 1]))) break;
+        index++;
+    }
+    if(index >= mapped.size){
+        file_unmap(&mapped);
+        return false;
+    }
+    index++;
+
+    char dependency[FILE_PATH_MAX];
+    size_t length = 0;
+    for (; index <= mapped.size; index++) {
+        char c = index < mapped.size ? data[index] : '\n';
+        char next = index + 1 < mapped.size ? data[index + 1] : '\0';
+        bool separator = false;
+        if(c == '\\' && (next == ' ' || next == '#')){
+            //escaped character inside a path
+            c = next;
+            index++;
+        }else if(c == '\\' && (next == '\n' || next == '\r')){
+            //line continuation
+            separator = true;
+        }else if(c == '$' && next == '$'){
+            index++;
+        }else if(isspace((unsigned char)c)){
+            separator = true;
+        }
+        if(separator){
+            if(length > 0){
+                dependency[length] = '\0';
+                string_list_add(dependencies,dependency);
+                length = 0;
+            }
+            continue;
+        }
+        if(length + 1 < FILE_PATH_MAX) dependency[length++] = c;
+    }
+    file_unmap(&mapped);
+    return true;
+}
+
+//an output is up to date when it exists, was built with the same command and nothing it was built from is newer
+//compiles check the depfile from the last compile, or the include scanner when there isn't one yet
+//paths of a step are relative to the project folder, where it runs
+static void build_step_path(const CbsBuild *build,const char *path,char *buffer){
+    if(path_is_absolute(path)) snprintf(buffer,FILE_PATH_MAX,"%s",path);
+    else snprintf(buffer,FILE_PATH_MAX,"%s%s",build->program_path,path);
+}
+
+static bool build_step_is_up_to_date(CbsBuild *build,int job_index){
+    CbsJob *job = &build->jobs[job_index];
+    const CbsStep *step = job->step;
+    CbsRecord *record = map_get(&build->records,job->output_path);
+    if(record == NULL || record->command_hash != hash_string(job->command_line)) return false;
+
+    //the oldest output decides, one that came out unchanged counts from when the step last ran
+    char path[FILE_PATH_MAX];
+    int64_t output_ns = INT64_MAX;
+    for (int i = 0; i < step->outputs.length; i++) {
+        build_step_path(build,step->outputs.items[i],path);
+        int64_t modified_ns = 0;
+        if(try_get_file_modified_time(path,&modified_ns) == false) return false;
+        CbsRecord *output_record = map_get(&build->records,path);
+        if(output_record != NULL && output_record->restat_ns > modified_ns) modified_ns = output_record->restat_ns;
+        if(modified_ns < output_ns) output_ns = modified_ns;
+    }
+
+    for (int i = 0; i < job->dependencies_length; i++) {
+        if(build->jobs[job->dependencies[i]].state == CBS_JOB_SUCCEEDED) return false;
+    }
+    for (int i = 0; i < step->inputs.length; i++) {
+        build_step_path(build,step->inputs.items[i],path);
+        int64_t input_ns = 0;
+        if(try_get_file_modified_time(path,&input_ns) == false || input_ns > output_ns) return false;
+    }
+    if(job->depfile_path == NULL) return true;
+
+    CbsStringList dependencies = {0};
+    bool up_to_date = read_depfile(job->depfile_path,&dependencies);
+    for (int i = 0; i < dependencies.length && up_to_date; i++) {
+        build_step_path(build,dependencies.items[i],path);
+        int64_t input_ns = 0;
+        up_to_date = try_get_file_modified_time(path,&input_ns) && input_ns <= output_ns;
+    }
+    string_list_free(&dependencies);
+    return up_to_date;
+}
+
+static bool build_job_is_up_to_date(CbsBuild *build,int job_index){
+    CbsJob *job = &build->jobs[job_index];
+    if(cbs_options.changed_from != NULL) return job->selected == false;
+    if(job->kind == CBS_JOB_STEP) return build_step_is_up_to_date(build,job_index);
+    int64_t output_ns = 0;
+    if(try_get_file_modified_time(job->output_path,&output_ns) == false) return false;
+    int64_t dwo_ns = 0;
+    if(job->dwo_path != NULL && try_get_file_modified_time(job->dwo_path,&dwo_ns) == false) return false;
+
+    CbsRecord *record = map_get(&build->records,job->output_path);
+    if(record == NULL || record->command_hash != hash_string(job->command_line)) return false;
+    //an output that came out unchanged keeps its old time, but everything it was built from is still up to date
+    if(record->restat_ns > output_ns) output_ns = record->restat_ns;
+
+    if(build->mode.input_path != NULL && job->kind == CBS_JOB_COMPILE){
+        int64_t input_ns = 0;
+        if(try_get_file_modified_time(build->mode.input_path,&input_ns) == false || input_ns > output_ns) return false;
+    }
+
+    for (int i = 0; i < job->dependencies_length; i++) {
+        const CbsJob *dependency = &build->jobs[job->dependencies[i]];
+        //steps only order the compiles, a compile reads what it includes through its depfile
+        if(dependency->kind == CBS_JOB_STEP) continue;
+        //ran this build, matters for --dry-run where nothing gets written
+        if(dependency->state == CBS_JOB_SUCCEEDED) return false;
+        int64_t dependency_ns = 0;
+        if(try_get_file_modified_time(dependency->output_path,&dependency_ns) == false || dependency_ns > output_ns){
+            return false;
+        }
+    }
+
+    if(job->input_path == NULL) return true;
+
+    CbsStringList dependencies = {0};
+    bool up_to_date = true;
+    if(job->depfile_path != NULL && read_depfile(job->depfile_path,&dependencies)){
+        for (int i = 0; i < dependencies.length && up_to_date; i++) {
+            CbsScannedFile *file = build_get_scanned_file(build,dependencies.items[i]);
+            up_to_date = file->exists && file->modified_ns <= output_ns;
+        }
+    }else{
+        build->visit_generation++;
+        up_to_date = build_includes_newer_than(build,job->module_index,job->input_path,output_ns) == false;
+    }
+    string_list_free(&dependencies);
+    return up_to_date;
+}
+
+// ==========================================
+// ============ CHANGED FILES ===============
+// ==========================================
+
+typedef struct CbsIndexList{
+    int *items;
+    int length;
+    int capacity;
+}CbsIndexList;
+
+static void index_list_add(CbsIndexList *list,int index){
+    if(list->length == list->capacity){
+        list->capacity = list->capacity == 0 ? 4 : list->capacity * 2;
+        list->items = realloc(list->items,sizeof(int) * list->capacity);
+    }
+    list->items[list->length++] = index;
+}
+
+static bool read_file_list(const char *path,CbsStringList *lines){
+    FILE *file = strcmp(path,"-") == 0 ? stdin : fopen(path,"r");
+    if(file == NULL) return false;
+    char line[FILE_PATH_MAX];
+    while(fgets(line,sizeof(line),file) != NULL){
+        line[strcspn(line,"\r\n")] = '\0';
+        if(string_is_null_empty_or_whitespace(line)) continue;
+        string_list_add(lines,line);
+    }
+    if(file != stdin) fclose(file);
+    return true;
+}
+
+//the depfile of the last compile when there is one, otherwise what the include scanner finds
+static void build_collect_dependencies(CbsBuild *build,int job_index,CbsStringList *dependencies){
+    CbsJob *job = &build->jobs[job_index];
+    if(job->kind == CBS_JOB_STEP){
+        CbsStringList depfile_dependencies = {0};
+        if(job->depfile_path != NULL) read_depfile(job->depfile_path,&depfile_dependencies);
+        char path[FILE_PATH_MAX];
+        for (int i = 0; i < job->step->inputs.length + depfile_dependencies.length; i++) {
+            bool declared = i < job->step->inputs.length;
+            build_step_path(build,declared ? job->step->inputs.items[i] : depfile_dependencies.items[i - job->step->inputs.length],path);
+            string_list_add(dependencies,path);
+        }
+        string_list_free(&depfile_dependencies);
+        return;
+    }
+    string_list_add(dependencies,job->input_path);
+    if(job->depfile_path != NULL && read_depfile(job->depfile_path,dependencies)) return;
+    build->visit_generation++;
+    build_collect_includes(build,job->module_index,job->input_path,dependencies);
+}
+
+static void build_mark_affected(CbsBuild *build,int job_index){
+    CbsJob *job = &build->jobs[job_index];
+    if(job->selected) return;
+    job->selected = true;
+    for (int i = 0; i < job->dependents_length; i++) {
+        build_mark_affected(build,job->dependents[i]);
+    }
+}
+
+//an affected job also needs every input that was never built, e.g. on a fresh CI machine
+static void build_mark_missing_inputs(CbsBuild *build,int job_index){
+    CbsJob *job = &build->jobs[job_index];
+    for (int i = 0; i < job->dependencies_length; i++) {
+        CbsJob *dependency = &build->jobs[job->dependencies[i]];
+        int64_t modified_ns = 0;
+        if(dependency->selected || try_get_file_modified_time(dependency->output_path,&modified_ns)) continue;
+        dependency->selected = true;
+        build_mark_missing_inputs(build,job->dependencies[i]);
+    }
+}
+
+//--changed-from: only compiles and steps that read a changed file, and the links downstream of them, run.
+//what a selected step writes counts as changed too
+static bool build_select_changed_jobs(CbsBuild *build){
+    CbsStringList changed_files = {0};
+    if(read_file_list(cbs_options.changed_from,&changed_files) == false){
+        cbs_log_error("couldn't read changed files from [%s]",cbs_options.changed_from);
+        return false;
+    }
+
+    //reverse index from every source and header to the compiles and steps that read it
+    CbsMap compiles_by_file = {0};
+    char normalized[FILE_PATH_MAX];
+    for (int j = 0; j < build->job_count; j++) {
+        if(build->jobs[j].kind != CBS_JOB_COMPILE && build->jobs[j].kind != CBS_JOB_STEP) continue;
+        CbsStringList dependencies = {0};
+        build_collect_dependencies(build,j,&dependencies);
+        for (int i = 0; i < dependencies.length; i++) {
+            normalize_path(build->program_path,dependencies.items[i],normalized);
+            CbsIndexList *compiles = map_get(&compiles_by_file,normalized);
+            if(compiles == NULL){
+                compiles = calloc(1,sizeof(CbsIndexList));
+                map_put(&compiles_by_file,normalized,compiles);
+            }
+            if(compiles->length == 0 || compiles->items[compiles->length - 1] != j){
+                index_list_add(compiles,j);
+            }
+        }
+        string_list_free(&dependencies);
+    }
+
+    int listed_count = changed_files.length;
+    for (int c = 0; c < changed_files.length; c++) {
+        normalize_path(build->program_path,changed_files.items[c],normalized);
+        CbsIndexList *compiles = map_get(&compiles_by_file,normalized);
+        if(compiles != NULL){
+            for (int i = 0; i < compiles->length; i++) {
+                CbsJob *job = &build->jobs[compiles->items[i]];
+                if(job->kind != CBS_JOB_STEP){
+                    build_mark_affected(build,compiles->items[i]);
+                    continue;
+                }
+                //its dependents are every compile of the module, only those that read the outputs follow
+                if(job->selected) continue;
+                job->selected = true;
+                char output_path[FILE_PATH_MAX];
+                for (int o = 0; o < job->step->outputs.length; o++) {
+                    build_step_path(build,job->step->outputs.items[o],output_path);
+                    string_list_add(&changed_files,output_path);
+                }
+            }
+            continue;
+        }
+        //a deleted source is only known by being inside the source folder of a module
+        for (int m = 0; m < build->module_count; m++) {
+            char source_directory[FILE_PATH_MAX];
+            normalize_path(build->program_path,build->modules[m].source_file_directory,source_directory);
+            buffer_append_char(source_directory,FILE_PATH_MAX,FILE_SEPARATOR);
+            if(string_starts_with(normalized,source_directory)){
+                build_mark_affected(build,build->link_jobs[m]);
+            }
+        }
+    }
+
+    for (int j = 0; j < build->job_count; j++) {
+        if(build->jobs[j].selected) build_mark_missing_inputs(build,j);
+    }
+    int selected_count = 0;
+    for (int j = 0; j < build->job_count; j++) {
+        if(build->jobs[j].selected) selected_count++;
+    }
+    printf("%d changed file(s) affect %d of %d job(s)\n",listed_count,selected_count,build->job_count);
+
+    for (uint32_t i = 0; i < compiles_by_file.capacity; i++) {
+        if(compiles_by_file.entries[i].key == NULL) continue;
+        free(((CbsIndexList*)compiles_by_file.entries[i].value)->items);
+    }
+    map_free(&compiles_by_file,true);
+    string_list_free(&changed_files);
+    return true;
+}
+
+static uint64_t hash_file(const char *path){
+    CbsMappedFile mapped;
+    if(file_map(path,&mapped) == false) return 0;
+    uint64_t hash = hash_bytes(mapped.data,mapped.size,CBS_HASH_SEED);
+    file_unmap(&mapped);
+    return hash;
+}
+
+//early cutoff, like restat in ninja: an output identical to the last one gets its old time back
+//so the links and modules after it see nothing new
+static bool build_restat_output(const char *output_path,int64_t previous_output_ns,CbsRecord *record){
+    uint64_t previous_hash = record->output_hash;
+    int64_t written_ns = 0;
+    record->output_hash = 0;
+    record->restat_ns = 0;
+    if(try_get_file_modified_time(output_path,&written_ns) == false) return false;
+    record->output_hash = hash_file(output_path);
+    record->restat_ns = written_ns;
+
+    if(previous_hash == 0 || previous_hash != record->output_hash || previous_output_ns == 0) return false;
+    return set_file_modified_time(output_path,previous_output_ns);
+}
+
+static void build_step_remember_outputs(CbsBuild *build,int job_index){
+    CbsJob *job = &build->jobs[job_index];
+    if(job->previous_outputs_ns == NULL) job->previous_outputs_ns = calloc(job->step->outputs.length,sizeof(int64_t));
+    char path[FILE_PATH_MAX];
+    for (int i = 0; i < job->step->outputs.length; i++) {
+        build_step_path(build,job->step->outputs.items[i],path);
+        if(try_get_file_modified_time(path,&job->previous_outputs_ns[i]) == false) job->previous_outputs_ns[i] = 0;
+    }
+}
+
+//a step changed the file, what an earlier look at it found is stale
+static void build_forget_scanned_file(CbsBuild *build,const char *path){
+    CbsScannedFile *file = map_get(&build->scanned_files,path);
+    if(file == NULL) return;
+    file->exists = try_get_file_modified_time(path,&file->modified_ns);
+    if(file->includes_scanned == false) return;
+    string_list_free(&file->quoted_includes);
+    string_list_free(&file->angled_includes);
+    file->includes_scanned = false;
+}
+
+//every output of a step gets its own record, the step only counts as unchanged if all of them are
+static bool build_restat_step(CbsBuild *build,int job_index,CbsRecord *record){
+    CbsJob *job = &build->jobs[job_index];
+    bool unchanged = true;
+    char path[FILE_PATH_MAX];
+    for (int i = 0; i < job->step->outputs.length; i++) {
+        build_step_path(build,job->step->outputs.items[i],path);
+        CbsRecord *output_record = i == 0 ? record : record_get_or_create(&build->records,path);
+        if(build_restat_output(path,job->previous_outputs_ns[i],output_record) == false){
+            unchanged = false;
+            build_forget_scanned_file(build,path);
+        }
+    }
+    return unchanged;
+}
+
+//prints the job and everything it wrote as one block so parallel jobs never interleave
+static void build_report_job(CbsBuild *build,int job_index,int exit_code,const CbsStringBuilder *output,int finished_count){
+    CbsJob *job = &build->jobs[job_index];
+    printf("[%d/%d] %s\n",finished_count,build->job_count,job->display_name);
+    if(output->length > 0){
+        fwrite(output->items,1,output->length,stdout);
+    }
+    fflush(stdout);
+    if(exit_code != 0){
+        cbs_log_error("[%s] exited with code %d",job->display_name,exit_code);
+    }
+}
+
+//without -o the compiler replaces the source extension, "a.c.o" -> "a.o" and "a.c.d" -> "a.d".
+//a batch renames those to the real names once it's done
+static void batch_output_path(const char *path,char *path_buffer){
+    const char *extension = strrchr(path,'.');
+    char stem[FILE_PATH_MAX];
+    snprintf(stem,FILE_PATH_MAX,"%.*s",(int)(extension - path),path);
+    char *source_extension = strrchr(stem,'.');
+    if(source_extension != NULL) *source_extension = '\0';
+    snprintf(path_buffer,FILE_PATH_MAX,"%s%s",stem,extension);
+}
+
+//two sources with one stem would write the same object without -o
+static bool batch_has_stem(const CbsBuild *build,int first_index,const char *source_path){
+    const char *source_name = path_filename(source_path);
+    size_t stem_length = (size_t)(strrchr(source_name,'.') - source_name);
+    for (int i = first_index; i >= 0; i = build->jobs[i].batch_next) {
+        const char *name = path_filename(build->jobs[i].input_path);
+        if((size_t)(strrchr(name,'.') - name) == stem_length && strncmp(name,source_name,stem_length) == 0) return true;
+    }
+    return false;
+}
+
+//pops ready compiles that can share one compiler process with the first, until the batch takes about
+//CBS_BATCH_TARGET_MS by recorded durations or is big enough to keep every free slot busy
+//returns the batch size, jobs found up to date on the way are finished
+static int build_gather_batch(CbsBuild *build,int first_index,int free_slots,int *finished_count){
+    CbsJob *first = &build->jobs[first_index];
+    first->batch_next = -1;
+    if(first->batchable == false) return 1;
+
+    int limit = (build->ready_length + 1) / (free_slots < 1 ? 1 : free_slots);
+    if(limit > CBS_BATCH_MAX_SOURCES) limit = CBS_BATCH_MAX_SOURCES;
+    int count = 1;
+    int last_index = first_index;
+    uint64_t estimated_ms = first->estimated_ms;
+    CbsIndexList skipped = {0};
+    while(count < limit && estimated_ms < CBS_BATCH_TARGET_MS && build->ready_length > 0){
+        int job_index = build_pop_ready(build);
+        CbsJob *job = &build->jobs[job_index];
+        //without -o the compiler names each object after its source inside the working directory
+        if(job->batchable == false || job->module_index != first->module_index
+        || paths_share_directory(job->output_path,first->output_path) == false || batch_has_stem(build,first_index,job->input_path)){
+            index_list_add(&skipped,job_index);
+            continue;
+        }
+        if(build_job_is_up_to_date(build,job_index)){
+            (*finished_count)++;
+            build_finish_job(build,job_index,CBS_JOB_UP_TO_DATE);
+            continue;
+        }
+        job->batch_next = -1;
+        build->jobs[last_index].batch_next = job_index;
+        last_index = job_index;
+        estimated_ms += job->estimated_ms;
+        count++;
+    }
+    for (int i = 0; i < skipped.length; i++) {
+        build_push_ready(build,skipped.items[i]);
+    }
+    free(skipped.items);
+    return count;
+}
+
+typedef enum CbsCompilerFamily{
+    CBS_COMPILER_GCC,
+    CBS_COMPILER_CLANG,
+    CBS_COMPILER_MSVC
+}CbsCompilerFamily;
+
+static CbsCompilerFamily compiler_family(const char *compiler){
+    const char *filename = path_filename(compiler);
+    if(string_starts_with(filename,"clang-cl")) return CBS_COMPILER_MSVC;
+    if(strstr(filename,"clang") != NULL) return CBS_COMPILER_CLANG;
+    if(strcmp(filename,"cl") == 0 || strcmp(filename,"cl.exe") == 0) return CBS_COMPILER_MSVC;
+    return CBS_COMPILER_GCC;
+}
+
+static bool build_start_job(CbsBuild *build,CbsProcessPool *pool,int job_index,bool force_color){
+    CbsJob *job = &build->jobs[job_index];
+    CbsStringBuilder command = {0};
+    char object_directory[FILE_PATH_MAX];
+    const char *working_directory = NULL;
+    if(job->batch_next >= 0){
+        //every object and depfile lands in the working directory, named after its source
+        builder_append_string(&command,build->batch_prefixes[job->module_index]);
+        builder_append_string(&command,"-MMD -c ");
+        for (int i = job_index; i >= 0; i = build->jobs[i].batch_next) {
+            builder_append_quoted(&command,build->jobs[i].input_path);
+        }
+        snprintf(object_directory,FILE_PATH_MAX,"%.*s",(int)(path_filename(job->output_path) - job->output_path),job->output_path);
+        working_directory = object_directory;
+    }else{
+        builder_append_string(&command,job->command_line);
+        if(job->kind == CBS_JOB_STEP || build->modules[job->module_index].reproducible) working_directory = build->program_path;
+    }
+    if(job->launch_flags != NULL){
+        builder_append_string(&command,job->launch_flags);
+    }
+    //only gcc and clang know the flag, not cl, llvm-dwp or the command of a step
+    if(force_color && (job->kind == CBS_JOB_COMPILE || job->kind == CBS_JOB_LINK)
+    && compiler_family(build->modules[job->module_index].compiler) != CBS_COMPILER_MSVC){
+        builder_append_string(&command," -fdiagnostics-color=always");
+    }
+    //__DATE__ and __TIME__ use it instead of the clock, CI can export the time of the commit instead
+    const char *environment = build->modules[job->module_index].reproducible ? CBS_REPRODUCIBLE_ENVIRONMENT : NULL;
+    bool started = process_pool_start(pool,command.items,working_directory,environment);
+    free(command.items);
+    return started;
+}
+
+//an llvm tool from the same folder and with the same version suffix as the compiler, clang-17 -> llvm-profdata-17
+static void llvm_tool_for_compiler(const char *compiler,const char *tool,char *buffer){
+    const char *filename = path_filename(compiler);
+    snprintf(buffer,FILE_PATH_MAX,"%.*s%s",(int)(filename - compiler),compiler,tool);
+    const char *version = strstr(filename,"clang");
+    if(version == NULL) return;
+    version += strlen("clang");
+    if(string_starts_with(version,"++")) version += 2;
+    if(version[0] == '-' && isdigit((unsigned char)version[1])){
+        buffer_append_string(buffer,FILE_PATH_MAX,version);
+    }
+}
+
+//flags can be written with or without their prefix, "Wall" and "-Wall" are the same
+static void append_prefixed_flags(CbsStringBuilder *builder,const CbsStringArray *flags,const char *prefix){
+    for (int i = 0; i < flags->length; i++) {
+        const char* flag = flags->items[i];
+        if(string_starts_with(flag,prefix) == false){
+            builder_append_string(builder,prefix);
+        }
+        builder_append_string(builder,flag);
+        builder_append_char(builder,' ');
+    }
+}
+
+static void append_compiler_flags(CbsStringBuilder *builder,const CbsModule *module){
+    append_prefixed_flags(builder,&module->shared_compiler_flags,"-");
+    append_prefixed_flags(builder,&module->unique_compiler_flags,"-");
+}
+
+//true when the user already picked a linker, e.g. -fuse-ld=gold
+static bool module_chooses_linker(const CbsModule *module){
+    const CbsStringArray flag_arrays[] = {
+        module->shared_compiler_flags,module->unique_compiler_flags,
+        module->shared_linker_flags,module->unique_linker_flags
+    };
+    for (int a = 0; a < 4; a++) {
+        for (int i = 0; i < flag_arrays[a].length; i++) {
+            if(strstr(flag_arrays[a].items[i],"fuse-ld=") != NULL) return true;
+        }
+    }
+    return false;
+}
+
+//jobs of a reproducible module run in the project folder, so paths inside it are written relative to it
+static const char* command_path(const CbsBuild *build,const CbsModule *module,const char *path){
+    if(module->reproducible && string_starts_with(path,build->program_path)) return &path[strlen(build->program_path)];
+    return path;
+}
+
+//what is left of the project path, e.g. the DW_AT_comp_dir of the debug info, is mapped to "."
+static void append_reproducible_flags(CbsStringBuilder *builder,const CbsBuild *build,const CbsModule *module){
+    if(module->reproducible == false) return;
+    if(compiler_family(module->compiler) == CBS_COMPILER_MSVC){
+        //no timestamps in the pe headers
+        builder_append_string(builder,"/Brepro ");
+        return;
+    }
+    char flag[FILE_PATH_MAX + 64];
+    snprintf(flag,sizeof(flag),"-ffile-prefix-map=\"%.*s\"=. ",(int)strlen(build->program_path) - 1,build->program_path);
+    builder_append_string(builder,flag);
+}
+
+//lto flags go on both the compiles and the link, only the link gets the thin lto cache
+//link parallelism goes to launch_flags so changing -j doesn't relink, NULL for compiles
+static void append_lto_flags(CbsStringBuilder *builder,CbsStringBuilder *launch_flags,const CbsBuild *build,const CbsModule *module){
+    if(module->lto == CBS_LTO_OFF) return;
+    CbsCompilerFamily family = compiler_family(module->compiler);
+    if(family == CBS_COMPILER_MSVC) return;
+
+    bool link = launch_flags != NULL;
+    int link_jobs = cbs_options.job_count > 0 ? cbs_options.job_count : processor_count();
+    char flag[FILE_PATH_MAX + 64];
+    if(family == CBS_COMPILER_GCC){
+        //gcc has no thin lto, its link is split into partitions that run in parallel either way
+        builder_append_string(builder,"-flto ");
+        if(link){
+            snprintf(flag,sizeof(flag)," -flto=%d",link_jobs);
+            builder_append_string(launch_flags,flag);
+        }
+        return;
+    }
+
+    if(module->lto == CBS_LTO_FULL){
+        builder_append_string(builder,"-flto ");
+        return;
+    }
+    builder_append_string(builder,"-flto=thin ");
+    if(link == false) return;
+
+    //only ever part of the command, so it's built there instead of in a FILE_PATH_MAX buffer
+#if defined(__APPLE__)
+    builder_append_string(builder,"-Wl,-cache_path_lto,\"");
+#else
+    //the cache and job flags are lld's, so lld is used unless another linker was picked
+    if(module_chooses_linker(module) == false){
+        builder_append_string(builder,"-fuse-ld=lld ");
+    }
+    builder_append_string(builder,"-Wl,--thinlto-cache-dir=\"");
+#endif
+    builder_append_string(builder,command_path(build,module,build->mode_path));
+    builder_append_string(builder,CBS_LTO_CACHE_DIRECTORY);
+    builder_append_char(builder,FILE_SEPARATOR);
+    builder_append_string(builder,module->name);
+    builder_append_string(builder,"\" ");
+#if defined(__APPLE__)
+    snprintf(flag,sizeof(flag),"-Wl,-prune_after_lto,%d -Wl,-max_relative_cache_size_lto,%d ",
+        CBS_LTO_CACHE_PRUNE_AFTER_HOURS * 3600,CBS_LTO_CACHE_MAX_PERCENT_OF_DISK);
+    builder_append_string(builder,flag);
+    snprintf(flag,sizeof(flag)," -Wl,-mllvm,-threads=%d",link_jobs);
+    builder_append_string(launch_flags,flag);
+#else
+    snprintf(flag,sizeof(flag),"-Wl,--thinlto-cache-policy=prune_after=%dh:cache_size_bytes=%dm:prune_interval=%dm ",
+        CBS_LTO_CACHE_PRUNE_AFTER_HOURS,CBS_LTO_CACHE_MAX_MEGABYTES,CBS_LTO_CACHE_PRUNE_INTERVAL_MINUTES);
+    builder_append_string(builder,flag);
+    snprintf(flag,sizeof(flag)," -Wl,--thinlto-jobs=%d",link_jobs);
+    builder_append_string(launch_flags,flag);
+#endif
+}
+
+static bool module_splits_dwarf(const CbsModule *module){
+#if defined(_WIN32) || defined(__APPLE__)
+    (void)module;
+    return false;
+#else
+    return module->debug_info.split_dwarf && compiler_family(module->compiler) != CBS_COMPILER_MSVC;
+#endif
+}
+
+//link is true for the link command, the flags go in front of the objects
+static void append_debug_info_flags(CbsStringBuilder *builder,const CbsModule *module,bool link){
+#if defined(_WIN32) || defined(__APPLE__)
+    (void)builder;
+    (void)module;
+    (void)link;
+#else
+    CbsCompilerFamily family = compiler_family(module->compiler);
+    if(family == CBS_COMPILER_MSVC) return;
+    const CbsDebugInfo *debug_info = &module->debug_info;
+    if(debug_info->split_dwarf && link == false){
+        builder_append_string(builder,"-gsplit-dwarf ");
+    }
+    //-gz compresses the sections of the object, and at link time asks the linker to compress the output's
+    if(debug_info->compress){
+        builder_append_string(builder,"-gz ");
+    }
+    if(debug_info->gdb_index){
+        if(link == false){
+            builder_append_string(builder,"-ggnu-pubnames ");
+        }else{
+            //bfd ld can't build the index
+            if(module_chooses_linker(module) == false){
+                builder_append_string(builder,family == CBS_COMPILER_CLANG ? "-fuse-ld=lld " : "-fuse-ld=gold ");
+            }
+            builder_append_string(builder,"-Wl,--gdb-index ");
+        }
+    }
+#endif
+}
+
+static void append_mode_flags(CbsStringBuilder *builder,const CbsBuild *build){
+    if(build->mode.compiler_flags == NULL) return;
+    builder_append_string(builder,build->mode.compiler_flags);
+    builder_append_char(builder,' ');
+}
+
+static void append_mode_linker_flags(CbsStringBuilder *builder,const CbsBuild *build){
+    if(build->mode.linker_flags == NULL) return;
+    builder_append_string(builder,build->mode.linker_flags);
+    builder_append_char(builder,' ');
+}
+
+static void append_include_paths(CbsStringBuilder *builder,const CbsModule *module){
+    const CbsStringArray path_arrays[] = {module->shared_include_paths,module->unique_include_paths};
+    for (int a = 0; a < 2; a++) {
+        for (int i = 0; i < path_arrays[a].length; i++) {
+            builder_append_string(builder,"-I");
+            builder_append_quoted(builder,path_arrays[a].items[i]);
+        }
+    }
+}
+
+static void append_library_paths_and_linker_flags(CbsStringBuilder *builder,const CbsModule *module){
+    const CbsStringArray path_arrays[] = {module->shared_library_paths,module->unique_library_paths};
+    for (int a = 0; a < 2; a++) {
+        for (int i = 0; i < path_arrays[a].length; i++) {
+            builder_append_string(builder,"-L");
+            builder_append_quoted(builder,path_arrays[a].items[i]);
+        }
+    }
+
+    append_prefixed_flags(builder,&module->shared_linker_flags,"-l");
+    append_prefixed_flags(builder,&module->unique_linker_flags,"-l");
+}
+
+static bool build_validate_module(const CbsModule *module){
+    if(string_is_null_empty_or_whitespace(module->name)){
+        cbs_log_error("[name] variable in the module struct is NULL. Must provide name");
+        return false;
+    }
+    if(string_is_null_empty_or_whitespace(module->compiler)){
+        cbs_log_error("[compiler] variable in module [%s] is null,empty or whitespace",module->name);
+        return false;
+    }
+    if(string_is_null_empty_or_whitespace(module->output_file_name_with_extension)){
+        cbs_log_error("[output_file_name_with_extension] variable in module [%s] is null,empty or whitespace",module->name);
+        return false;
+    }
+    if(string_is_null_empty_or_whitespace(module->source_file_directory)){
+        cbs_log_error("[source_file_directory] variable in module [%s] is null,empty or whitespace",module->name);
+        return false;
+    }
+    return true;
+}
+
+static int build_find_module(const CbsBuild *build,const char *name){
+    for (int i = 0; i < build->module_count; i++) {
+        if(strcmp(build->modules[i].name,name) == 0) return i;
+    }
+    return -1;
+}
+
+//0 = unvisited, 1 = on the current path, 2 = done
+static bool build_module_has_cycle(const CbsBuild *build,int module_index,uint8_t *visit_states){
+    if(visit_states[module_index] == 2) return false;
+    if(visit_states[module_index] == 1) return true;
+    visit_states[module_index] = 1;
+    const CbsModule *module = &build->modules[module_index];
+    for (int i = 0; i < module->module_dependencies.length; i++) {
+        int dependency_index = build_find_module(build,module->module_dependencies.items[i]);
+        if(dependency_index >= 0 && build_module_has_cycle(build,dependency_index,visit_states)){
+            cbs_log_error("module [%s] is part of a dependency cycle",module->name);
+            return true;
+        }
+    }
+    visit_states[module_index] = 2;
+    return false;
+}
+
+//appends the output directory of the module with a trailing separator
+static void build_output_directory(const CbsBuild *build,const CbsModule *module,char *path_buffer){
+    if(build->mode.output_directory != NULL){
+        snprintf(path_buffer,FILE_PATH_MAX,"%s",build->mode.output_directory);
+        return;
+    }
+    snprintf(path_buffer,FILE_PATH_MAX,"%s",build->program_path);
+    if(string_is_null_empty_or_whitespace(module->output_directory) == false){
+        buffer_append_string(path_buffer,FILE_PATH_MAX,module->output_directory);
+        if(string_ends_with_char(module->output_directory,FILE_SEPARATOR) == false){
+            buffer_append_char(path_buffer,FILE_PATH_MAX,FILE_SEPARATOR);
+        }
+    }
+}
+
+//the output directory of the module inside the output_subdirectory of the mode, if it has one
+static void build_mode_output_directory(const CbsBuild *build,const CbsModule *module,char *path_buffer){
+    build_output_directory(build,module,path_buffer);
+    if(build->mode.output_subdirectory == NULL) return;
+    buffer_append_string(path_buffer,FILE_PATH_MAX,build->mode.output_subdirectory);
+    buffer_append_char(path_buffer,FILE_PATH_MAX,FILE_SEPARATOR);
+}
+
+//objects mirror the source tree under .cbs/obj/<module>/, files outside it go under _ext.
+//the source extension stays in the name so "a.c" and "a.cc" in one folder don't share "a.c.o"
+static bool build_object_path(const CbsBuild *build,const CbsModule *module,const char *source_root,const char *source_path,char *object_path){
+    if(path_format(object_path,"%s%s%c%s%c",build->mode_path,CBS_OBJECT_DIRECTORY,FILE_SEPARATOR,module->name,FILE_SEPARATOR) == false){
+        return false;
+    }
+    if(string_starts_with(source_path,source_root)){
+        if(buffer_append_string(object_path,FILE_PATH_MAX,&source_path[strlen(source_root)]) == false) return false;
+    }else{
+        if(buffer_append_string(object_path,FILE_PATH_MAX,"_ext") == false) return false;
+        if(buffer_append_char(object_path,FILE_PATH_MAX,FILE_SEPARATOR) == false) return false;
+        size_t start = strlen(object_path);
+        if(buffer_append_string(object_path,FILE_PATH_MAX,source_path) == false) return false;
+        for (size_t i = start; object_path[i] != '\0'; i++) {
+            if(object_path[i] == ':' || object_path[i] == '/' || object_path[i] == '\\') object_path[i] = '_';
+        }
+    }
+    return buffer_append_string(object_path,FILE_PATH_MAX,".o");
+}
+
+//true when the object is named after its source, "a.c" -> "a.c.o". files under _ext aren't
+static bool build_object_matches_source_name(const char *object_path,const char *source_path){
+    const char *object_name = path_filename(object_path);
+    const char *source_name = path_filename(source_path);
+    size_t source_length = strlen(source_name);
+    return strncmp(object_name,source_name,source_length) == 0 && strcmp(&object_name[source_length],".o") == 0;
+}
+
+//compiler and flags shared by every compile of the module, include paths are made absolute
+//because a batch runs inside its object folder
+static char* build_batch_prefix(const CbsBuild *build,const CbsModule *module){
+    //a batch runs in another folder, so the same file would come out different with and without one.
+    //objects point to their .dwo by the name the compiler gave it, so a renamed batch object can't split dwarf
+    if(module->batch_compiles == false || module->reproducible || module_splits_dwarf(module)
+    || compiler_family(module->compiler) == CBS_COMPILER_MSVC) return NULL;
+    CbsStringBuilder prefix = {0};
+    builder_append_program(&prefix,module->compiler);
+    append_compiler_flags(&prefix,module);
+    append_mode_flags(&prefix,build);
+    append_lto_flags(&prefix,NULL,build,module);
+    append_debug_info_flags(&prefix,module,false);
+    const CbsStringArray path_arrays[] = {module->shared_include_paths,module->unique_include_paths};
+    for (int a = 0; a < 2; a++) {
+        for (int i = 0; i < path_arrays[a].length; i++) {
+            const char *include_path = path_arrays[a].items[i];
+            builder_append_string(&prefix,"-I\"");
+            if(path_is_absolute(include_path) == false) builder_append_string(&prefix,build->program_path);
+            builder_append_string(&prefix,include_path);
+            builder_append_string(&prefix,"\" ");
+        }
+    }
+    return prefix.items;
+}
+
+//false when the paths of the object don't fit, nothing is added then
+static bool build_add_compile_job(CbsBuild *build,int module_index,const char *source_root,const char *source_path){
+    const CbsModule *module = &build->modules[module_index];
+    char object_path[FILE_PATH_MAX];
+    //the compiler names the .dwo after the object
+    char dwo_path[FILE_PATH_MAX];
+    if(build_object_path(build,module,source_root,source_path,object_path) == false
+    || path_format(dwo_path,"%.*sdwo",(int)strlen(object_path) - 1,object_path) == false){
+        cbs_log_error("no object path for [%s] in module [%s]",source_path,module->name);
+        return false;
+    }
+    make_directories_for_file(object_path);
+    char depfile_path[FILE_PATH_MAX];
+    snprintf(depfile_path,FILE_PATH_MAX,"%s",object_path);
+    depfile_path[strlen(depfile_path) - 1] = 'd';
+
+    CbsStringBuilder command = {0};
+    builder_append_program(&command,module->compiler);
+    append_compiler_flags(&command,module);
+    append_mode_flags(&command,build);
+    append_lto_flags(&command,NULL,build,module);
+    append_debug_info_flags(&command,module,false);
+    append_reproducible_flags(&command,build,module);
+    append_include_paths(&command,module);
+    builder_append_string(&command,"-MMD -MF ");
+    builder_append_quoted(&command,command_path(build,module,depfile_path));
+    builder_append_string(&command,"-c ");
+    builder_append_quoted(&command,command_path(build,module,source_path));
+    builder_append_string(&command,"-o ");
+    builder_append_quoted(&command,command_path(build,module,object_path));
+
+    int job_index = build_add_job(build,CBS_JOB_COMPILE,module_index);
+    CbsJob *job = &build->jobs[job_index];
+    job->command_line = command.items;
+    job->input_path = string_duplicate(source_path);
+    job->output_path = string_duplicate(object_path);
+    job->depfile_path = string_duplicate(depfile_path);
+    if(module_splits_dwarf(module)){
+        job->dwo_path = string_duplicate(dwo_path);
+    }
+    job->batchable = build->batch_prefixes[module_index] != NULL && build_object_matches_source_name(object_path,source_path);
+    job->display_name = string_duplicate(string_starts_with(source_path,build->program_path) ? &source_path[strlen(build->program_path)] : source_path);
+
+    CbsRecord *record = map_get(&build->records,object_path);
+    if(record != NULL && record->duration_ms > 0){
+        job->estimated_ms = record->duration_ms;
+    }else{
+        job->estimated_ms = CBS_ESTIMATE_BASE_MS + get_file_size(source_path) / CBS_ESTIMATE_SOURCE_BYTES_PER_MS;
+    }
+
+    build_add_dependency(build,build->link_jobs[module_index],job_index);
+    //steps that already finished this build have nothing left to wait for, a compile
+    //found after one of them failed is skipped along with the link right away
+    bool step_failed = false;
+    for (int i = 0; i < module->steps.length; i++) {
+        void *step_entry = map_get(&build->step_jobs,module->steps.items[i].name);
+        if(step_entry == NULL){
+            cbs_log_error("step [%s] of module [%s] has no job",module->steps.items[i].name,module->name);
+            step_failed = true;
+            continue;
+        }
+        int step_index = (int)(intptr_t)step_entry - 1;
+        CbsJobState step_state = build->jobs[step_index].state;
+        if(step_state == CBS_JOB_SUCCEEDED || step_state == CBS_JOB_UNCHANGED || step_state == CBS_JOB_UP_TO_DATE) continue;
+        if(step_state == CBS_JOB_FAILED || step_state == CBS_JOB_SKIPPED){
+            step_failed = true;
+            continue;
+        }
+        build_add_dependency(build,job_index,step_index);
+    }
+    if(step_failed) build_skip_job(build,job_index);
+    return true;
+}
+
+//creates the link job of the module, its compiles come from build_scan_next_directory
+static bool build_begin_module(CbsBuild *build,int module_index){
+    const CbsModule *module = &build->modules[module_index];
+    CbsModuleScan *scan = &build->scans[module_index];
+
+    snprintf(scan->source_root,FILE_PATH_MAX,"%s%s",build->program_path,module->source_file_directory);
+    if(string_ends_with_char(scan->source_root,FILE_SEPARATOR) == false){
+        buffer_append_char(scan->source_root,FILE_PATH_MAX,FILE_SEPARATOR);
+    }
+    if(directory_exists(scan->source_root)==false){
+        cbs_log_error("source file directory [%s] in module [%s] doesnt exist",module->source_file_directory,module->name);
+        return false;
+    }
+
+    char output_path[FILE_PATH_MAX];
+    build_output_directory(build,module,output_path);
+    if(directory_exists(output_path)==false){
+        cbs_log_error("output directory [%s] in module [%s] doesnt exist",module->output_directory,module->name);
+        return false;
+    }
+    build_mode_output_directory(build,module,output_path);
+    make_directories_for_file(output_path);
+    buffer_append_string(output_path,FILE_PATH_MAX,module->output_file_name_with_extension);
+
+    int link_index = build_add_job(build,CBS_JOB_LINK,module_index);
+    build->link_jobs[module_index] = link_index;
+    build->batch_prefixes[module_index] = build_batch_prefix(build,module);
+
+    CbsJob *link_job = &build->jobs[link_index];
+    link_job->output_path = string_duplicate(output_path);
+    link_job->display_name = string_duplicate(module->output_file_name_with_extension);
+    CbsRecord *record = map_get(&build->records,output_path);
+    if(record != NULL && record->duration_ms > 0){
+        link_job->estimated_ms = record->duration_ms;
+    }else{
+        link_job->estimated_ms = CBS_ESTIMATE_BASE_MS;
+    }
+    //held back until the scan is finished, see build_finish_module_scan
+    link_job->pending_dependencies++;
+
+    source_matcher_init(&scan->matcher,module,strlen(build->program_path));
+    string_list_add(&scan->pending_directories,scan->source_root);
+    return true;
+}
+
+static void build_add_scanned_source(CbsBuild *build,int module_index,const char *source_path){
+    if(build_add_compile_job(build,module_index,build->scans[module_index].source_root,source_path) == false){
+        build->scans[module_index].source_failed = true;
+        return;
+    }
+    build->scans[module_index].source_count++;
+    int job_index = build->job_count - 1;
+    if(build->started && build->jobs[job_index].pending_dependencies == 0 && build->jobs[job_index].state == CBS_JOB_WAITING){
+        build_compute_priority(build,job_index);
+        build_push_ready(build,job_index);
+    }
+}
+
+static bool build_validate_step(const CbsStep *step,const CbsModule *module){
+    if(string_is_null_empty_or_whitespace(step->name)){
+        cbs_log_error("a step of module [%s] has no name",module->name);
+        return false;
+    }
+    if(string_is_null_empty_or_whitespace(step->command)){
+        cbs_log_error("step [%s] has no command",step->name);
+        return false;
+    }
+    if(step->outputs.length < 1){
+        cbs_log_error("step [%s] has no outputs, without them it can't tell when it's up to date",step->name);
+        return false;
+    }
+    return true;
+}
+
+static bool string_arrays_equal(const CbsStringArray *a,const CbsStringArray *b){
+    if(a->length != b->length) return false;
+    for (int i = 0; i < a->length; i++) {
+        if(strcmp(a->items[i],b->items[i]) != 0) return false;
+    }
+    return true;
+}
+
+//steps are told apart by name, so modules can list the same step without it running twice
+static bool steps_are_same(const CbsStep *a,const CbsStep *b){
+    if(a == b) return true;
+    bool same_depfile = a->depfile == NULL || b->depfile == NULL ? a->depfile == b->depfile : strcmp(a->depfile,b->depfile) == 0;
+    return same_depfile && strcmp(a->command,b->command) == 0
+        && string_arrays_equal(&a->inputs,&b->inputs) && string_arrays_equal(&a->outputs,&b->outputs);
+}
+
+//a step's input that another step writes makes it wait for that step
+static void build_add_step_job(CbsBuild *build,const CbsStep *step,int module_index){
+    char path[FILE_PATH_MAX];
+    int job_index = build_add_job(build,CBS_JOB_STEP,module_index);
+    CbsJob *job = &build->jobs[job_index];
+    job->step = step;
+    job->command_line = string_duplicate(step->command);
+    job->display_name = string_duplicate(step->name);
+    build_step_path(build,step->outputs.items[0],path);
+    job->output_path = string_duplicate(path);
+    if(step->depfile != NULL){
+        build_step_path(build,step->depfile,path);
+        job->depfile_path = string_duplicate(path);
+    }
+    CbsRecord *record = map_get(&build->records,job->output_path);
+    job->estimated_ms = record != NULL && record->duration_ms > 0 ? record->duration_ms : CBS_ESTIMATE_BASE_MS;
+    map_put(&build->step_jobs,step->name,(void*)(intptr_t)(job_index + 1));
+
+    for (int j = 0; j < job_index; j++) {
+        const CbsStep *other = build->jobs[j].step;
+        if(other == NULL) continue;
+        bool reads_other = false;
+        for (int i = 0; i < step->inputs.length && reads_other == false; i++) {
+            for (int o = 0; o < other->outputs.length && reads_other == false; o++) {
+                reads_other = strcmp(step->inputs.items[i],other->outputs.items[o]) == 0;
+            }
+        }
+        if(reads_other) build_add_dependency(build,job_index,j);
+    }
+}
+
+//outputs of the module's steps that are sources, the scan can't see them before they were generated once
+static void build_add_generated_sources(CbsBuild *build,int module_index){
+    const CbsModule *module = &build->modules[module_index];
+    const CbsStringList *extensions = &build->scans[module_index].matcher.extensions;
+    char path[FILE_PATH_MAX];
+    for (int s = 0; s < module->steps.length; s++) {
+        const CbsStep *step = &module->steps.items[s];
+        for (int o = 0; o < step->outputs.length; o++) {
+            bool is_source = false;
+            for (int e = 0; e < extensions->length && is_source == false; e++) {
+                is_source = string_ends_with_string(step->outputs.items[o],extensions->items[e]);
+            }
+            if(is_source == false) continue;
+            build_step_path(build,step->outputs.items[o],path);
+            bool scanned = false;
+            for (int j = 0; j < build->job_count && scanned == false; j++) {
+                const CbsJob *job = &build->jobs[j];
+                scanned = job->kind == CBS_JOB_COMPILE && job->module_index == module_index && strcmp(job->input_path,path) == 0;
+            }
+            if(scanned == false) build_add_scanned_source(build,module_index,path);
+        }
+    }
+}
+
+//dwp reads the .dwo files the output points to, so it only has to wait for the link
+static void build_add_package_job(CbsBuild *build,int module_index){
+    const CbsModule *module = &build->modules[module_index];
+    int link_index = build->link_jobs[module_index];
+    //binutils dwp can't read the DWARF 5 that gcc writes since gcc 11, so gcc uses llvm-dwp too
+    char tool[FILE_PATH_MAX];
+    if(compiler_family(module->compiler) == CBS_COMPILER_CLANG){
+        llvm_tool_for_compiler(module->compiler,"llvm-dwp",tool);
+    }else{
+        snprintf(tool,FILE_PATH_MAX,"llvm-dwp");
+    }
+    char package_path[FILE_PATH_MAX];
+    snprintf(package_path,FILE_PATH_MAX,"%s.dwp",build->jobs[link_index].output_path);
+
+    CbsStringBuilder command = {0};
+    builder_append_string(&command,tool);
+    builder_append_string(&command," -e ");
+    builder_append_quoted(&command,command_path(build,module,build->jobs[link_index].output_path));
+    builder_append_string(&command,"-o ");
+    builder_append_quoted(&command,command_path(build,module,package_path));
+
+    int job_index = build_add_job(build,CBS_JOB_PACKAGE,module_index);
+    CbsJob *job = &build->jobs[job_index];
+    job->command_line = command.items;
+    job->output_path = string_duplicate(package_path);
+    job->display_name = string_duplicate(path_filename(package_path));
+    CbsRecord *record = map_get(&build->records,package_path);
+    job->estimated_ms = record != NULL && record->duration_ms > 0 ? record->duration_ms : CBS_ESTIMATE_BASE_MS;
+    build_add_dependency(build,job_index,link_index);
+}
+
+//every object of the module is known now, so the link command can be put together and the link released
+static bool build_finish_module_scan(CbsBuild *build,int module_index){
+    const CbsModule *module = &build->modules[module_index];
+    CbsModuleScan *scan = &build->scans[module_index];
+    scan->finished = true;
+    build_add_generated_sources(build,module_index);
+    source_matcher_free(&scan->matcher);
+    string_list_free(&scan->pending_directories);
+    for(int i = 0; i<module->additional_source_file_paths.length; i++){
+        build_add_scanned_source(build,module_index,module->additional_source_file_paths.items[i]);
+    }
+
+    int link_index = build->link_jobs[module_index];
+    if(scan->source_count == 0 || scan->source_failed){
+        if(scan->source_count == 0) cbs_log_error("no source files found for module [%s]",module->name);
+        build->scan_failed = true;
+        if(build->started) build_finish_job(build,link_index,CBS_JOB_FAILED);
+        return false;
+    }
+
+    CbsStringBuilder command = {0};
+    builder_append_program(&command,module->compiler);
+    append_compiler_flags(&command,module);
+    append_mode_flags(&command,build);
+    CbsStringBuilder launch_flags = {0};
+    append_lto_flags(&command,&launch_flags,build,module);
+    append_debug_info_flags(&command,module,true);
+    append_reproducible_flags(&command,build,module);
+    for (int i = 0; i < build->job_count; i++) {
+        const CbsJob *job = &build->jobs[i];
+        if(job->kind != CBS_JOB_COMPILE || job->module_index != module_index) continue;
+        builder_append_quoted(&command,command_path(build,module,job->output_path));
+    }
+    //a mode that moves outputs has to point the linker at the moved outputs of the modules this one uses
+    if(build->mode.output_directory != NULL || build->mode.output_subdirectory != NULL){
+        for (int d = 0; d < module->module_dependencies.length; d++) {
+            int dependency_index = build_find_module(build,module->module_dependencies.items[d]);
+            if(dependency_index < 0) continue;
+            char dependency_directory[FILE_PATH_MAX];
+            build_mode_output_directory(build,&build->modules[dependency_index],dependency_directory);
+            builder_append_string(&command,"-L");
+            builder_append_quoted(&command,command_path(build,module,dependency_directory));
+        }
+    }
+    append_library_paths_and_linker_flags(&command,module);
+    append_mode_linker_flags(&command,build);
+    builder_append_string(&command,"-o ");
+    builder_append_quoted(&command,command_path(build,module,build->jobs[link_index].output_path));
+
+    CbsJob *link_job = &build->jobs[link_index];
+    link_job->command_line = command.items;
+    link_job->launch_flags = launch_flags.items;
+    if(map_get(&build->records,link_job->output_path) == NULL){
+        link_job->estimated_ms = CBS_ESTIMATE_BASE_MS + (uint64_t)scan->source_count * CBS_ESTIMATE_LINK_MS_PER_OBJECT;
+    }
+    if(module_splits_dwarf(module) && module->debug_info.package_dwp){
+        build_add_package_job(build,module_index);
+        link_job = &build->jobs[link_index];
+    }
+    if(--link_job->pending_dependencies == 0 && build->started && link_job->state == CBS_JOB_WAITING){
+        build_push_ready(build,link_index);
+    }
+    return true;
+}
+
+//reads one folder of the module being scanned, false once every module is scanned
+static bool build_scan_next_directory(CbsBuild *build){
+    while(build->scanning_module < build->module_count && build->scans[build->scanning_module].finished){
+        build->scanning_module++;
+    }
+    if(build->scanning_module == build->module_count) return false;
+
+    int module_index = build->scanning_module;
+    CbsModuleScan *scan = &build->scans[module_index];
+    if(scan->pending_directories.length == 0){
+        build_finish_module_scan(build,module_index);
+        return true;
+    }
+    char *next = scan->pending_directories.items[--scan->pending_directories.length];
+    char directory[FILE_PATH_MAX];
+    snprintf(directory,FILE_PATH_MAX,"%s",next);
+    free(next);
+
+    //the order folders list their files in depends on the file system, sorting keeps link lines the same everywhere.
+    //subfolders are sorted backwards because the last one pushed is read first
+    CbsStringList source_files = {0};
+    int first_subdirectory = scan->pending_directories.length;
+    add_files_from_source_directory(directory,&source_files,&scan->pending_directories,&scan->matcher);
+    qsort(source_files.items,source_files.length,sizeof(char*),compare_strings);
+    CbsStringList *pending = &scan->pending_directories;
+    qsort(&pending->items[first_subdirectory],pending->length - first_subdirectory,sizeof(char*),compare_strings);
+    for (int a = first_subdirectory,b = pending->length - 1; a < b; a++,b--) {
+        char *swap = pending->items[a];
+        pending->items[a] = pending->items[b];
+        pending->items[b] = swap;
+    }
+    for (int i = 0; i < source_files.length; i++) {
+        build_add_scanned_source(build,module_index,source_files.items[i]);
+    }
+    string_list_free(&source_files);
+    return true;
+}
+
+//finishes discovery up front, for everything that needs the whole graph before running anything
+static bool build_scan_sources(CbsBuild *build){
+    while(build_scan_next_directory(build)){}
+    return build->scan_failed == false;
+}
+
+//with jobs running in their own process groups, Ctrl-C only reaches them through us
+static bool build_should_stop(const CbsBuild *build){
+    if(cbs_interrupted) return true;
+    return build->failed_count > 0 && cbs_options.keep_going == false;
+}
+
+//moves what the compiler wrote for a batched source to the names the job expects
+static bool build_rename_batch_outputs(const CbsJob *job){
+    const char *paths[] = {job->output_path,job->depfile_path};
+    char batch_path[FILE_PATH_MAX];
+    for (int i = 0; i < 2; i++) {
+        batch_output_path(paths[i],batch_path);
+        remove(paths[i]);
+        if(rename(batch_path,paths[i]) != 0){
+            cbs_log_error("couldn't rename [%s] to [%s]",batch_path,paths[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+//what a killed job had written so far is incomplete and must not look up to date next time
+static void build_remove_partial_outputs(CbsBuild *build,int job_index){
+    for (int i = job_index; i >= 0; i = build->jobs[i].batch_next) {
+        CbsJob *job = &build->jobs[i];
+        remove(job->output_path);
+        if(job->depfile_path != NULL) remove(job->depfile_path);
+        if(job->dwo_path != NULL) remove(job->dwo_path);
+        for (int o = 0; job->step != NULL && o < job->step->outputs.length; o++) {
+            char output_path[FILE_PATH_MAX];
+            build_step_path(build,job->step->outputs.items[o],output_path);
+            remove(output_path);
+        }
+        job->state = CBS_JOB_SKIPPED;
+    }
+}
+
+typedef struct CbsCompletedJob{
+    int job_index;
+    int exit_code;
+    CbsStringBuilder output;
+}CbsCompletedJob;
+
+static bool build_run_jobs(CbsBuild *build){
+    int job_limit = cbs_options.job_count > 0 ? cbs_options.job_count : processor_count();
+    if(job_limit > CBS_MAX_PARALLEL_PROCESSES) job_limit = CBS_MAX_PARALLEL_PROCESSES;
+
+    //output goes through pipes, so the compiler has to be told to keep its colors
+    bool force_color = output_is_terminal();
+
+    CbsProcessPool pool;
+    process_pool_init(&pool,job_limit);
+    int *running_jobs = calloc(job_limit,sizeof(int));
+    CbsCompletedJob *completed = calloc(job_limit,sizeof(CbsCompletedJob));
+    int finished_count = 0;
+    bool wait_failed = false;
+
+    build->started = true;
+    for (int i = 0; i < build->job_count; i++) {
+        if(build->jobs[i].pending_dependencies == 0){
+            build_push_ready(build,i);
+        }
+    }
+
+    while(wait_failed == false && cbs_interrupted == false){
+        if(cbs_options.fail_fast && build->failed_count > 0) break;
+        //one folder per turn, so the compiles found so far run while the rest is still being read
+        bool scanning = build_scan_next_directory(build);
+        while(pool.count < job_limit && build->ready_length > 0 && build_should_stop(build) == false){
+            int job_index = build_pop_ready(build);
+            CbsJob *job = &build->jobs[job_index];
+            if(build_job_is_up_to_date(build,job_index)){
+                finished_count++;
+                build_finish_job(build,job_index,CBS_JOB_UP_TO_DATE);
+                continue;
+            }
+
+            if(cbs_options.dry_run){
+                printf("[%d/%d] %s (dry run)\n",++finished_count,build->job_count,job->display_name);
+                build->ran_count++;
+                build_finish_job(build,job_index,CBS_JOB_SUCCEEDED);
+                continue;
+            }
+
+            build_gather_batch(build,job_index,job_limit - pool.count,&finished_count);
+            if(build_start_job(build,&pool,job_index,force_color) == false){
+                //the batch goes back to be started one at a time, a single job fails
+                if(job->batch_next >= 0){
+                    for (int i = job_index; i >= 0; i = build->jobs[i].batch_next) {
+                        build->jobs[i].batchable = false;
+                        build_push_ready(build,i);
+                    }
+                    continue;
+                }
+                CbsStringBuilder no_output = {0};
+                build_report_job(build,job_index,-1,&no_output,++finished_count);
+                build_finish_job(build,job_index,CBS_JOB_FAILED);
+                continue;
+            }
+            for (int i = job_index; i >= 0; i = build->jobs[i].batch_next) {
+                CbsJob *started_job = &build->jobs[i];
+                started_job->state = CBS_JOB_RUNNING;
+                started_job->start_ms = time_now_ms();
+                if(try_get_file_modified_time(started_job->output_path,&started_job->previous_output_ns) == false){
+                    started_job->previous_output_ns = 0;
+                }
+                if(started_job->step != NULL) build_step_remember_outputs(build,i);
+                build->ran_count++;
+            }
+            running_jobs[pool.count - 1] = job_index;
+        }
+        if(pool.count == 0){
+            if(scanning) continue;
+            break;
+        }
+
+        //block for one job unless there are folders left to read, then collect any others that finished in the meantime
+        int completed_count = 0;
+        int exit_code = 1;
+        int slot = process_pool_wait(&pool,scanning ? 0 : -1,&exit_code);
+        while(slot >= 0){
+            completed[completed_count].job_index = running_jobs[slot];
+            completed[completed_count].exit_code = exit_code;
+            completed[completed_count].output = process_pool_remove(&pool,slot);
+            running_jobs[slot] = running_jobs[pool.count];
+            completed_count++;
+            slot = process_pool_wait(&pool,0,&exit_code);
+        }
+        wait_failed = slot == -2;
+        //with -3 the loop ends on cbs_interrupted
+
+        //failures are printed ahead of jobs that succeeded
+        for (int pass = 0; pass < 2; pass++) {
+            for (int i = 0; i < completed_count; i++) {
+                CbsCompletedJob *completed_job = &completed[i];
+                bool failed = completed_job->exit_code != 0;
+                if(failed != (pass == 0)) continue;
+
+                int batch_size = 0;
+                for (int j = completed_job->job_index; j >= 0; j = build->jobs[j].batch_next) {
+                    batch_size++;
+                }
+                //a failed batch doesn't say which file failed, so each one is compiled on its own again
+                if(failed && batch_size > 1){
+                    for (int j = completed_job->job_index; j >= 0; j = build->jobs[j].batch_next) {
+                        build->jobs[j].batchable = false;
+                        build->ran_count--;
+                        build_push_ready(build,j);
+                    }
+                    free(completed_job->output.items);
+                    continue;
+                }
+
+                //the whole output is printed with the first file of a batch, the time is split evenly
+                CbsStringBuilder no_output = {0};
+                int job_index = completed_job->job_index;
+                while(job_index >= 0){
+                    CbsJob *job = &build->jobs[job_index];
+                    int next_index = job->batch_next;
+                    CbsJobState state = failed ? CBS_JOB_FAILED : CBS_JOB_SUCCEEDED;
+                    if(failed == false && batch_size > 1 && build_rename_batch_outputs(job) == false){
+                        state = CBS_JOB_FAILED;
+                    }else if(failed == false){
+                        CbsRecord *record = record_get_or_create(&build->records,job->output_path);
+                        record->duration_ms = (time_now_ms() - job->start_ms) / (uint64_t)batch_size;
+                        record->command_hash = hash_string(job->command_line);
+                        if(job->step != NULL){
+                            if(build_restat_step(build,job_index,record)){
+                                state = CBS_JOB_UNCHANGED;
+                                build->unchanged_count++;
+                            }
+                        }else if(build_restat_output(job->output_path,job->previous_output_ns,record)){
+                            state = CBS_JOB_UNCHANGED;
+                            build->unchanged_count++;
+                        }
+                    }
+                    const CbsStringBuilder *output = job_index == completed_job->job_index ? &completed_job->output : &no_output;
+                    build_report_job(build,job_index,completed_job->exit_code,output,++finished_count);
+                    job->batch_next = -1;
+                    build_finish_job(build,job_index,state);
+                    job_index = next_index;
+                }
+                free(completed_job->output.items);
+            }
+        }
+    }
+
+    //still running after --fail-fast, Ctrl-C or a failed wait
+    int cancelled_count = pool.count;
+    process_pool_cancel(&pool);
+    for (int slot = 0; slot < cancelled_count; slot++) {
+        build_remove_partial_outputs(build,running_jobs[slot]);
+    }
+    int not_started_count = 0;
+    for (int i = 0; i < build->job_count; i++) {
+        if(build->jobs[i].state == CBS_JOB_WAITING || build->jobs[i].state == CBS_JOB_READY) not_started_count++;
+    }
+
+    process_pool_free(&pool);
+    free(running_jobs);
+    free(completed);
+    if(cbs_interrupted){
+        cbs_log_error("interrupted, %d running job(s) killed",cancelled_count);
+    }else if(cancelled_count > 0){
+        cbs_log_error("stopped after the first failure, %d running job(s) killed",cancelled_count);
+    }
+    if(not_started_count > 0 && cbs_interrupted == false){
+        printf("%d job(s) not started because of the failure, -k keeps going\n",not_started_count);
+    }
+    if(build->ran_count == 0 && build->failed_count == 0 && cbs_interrupted == false){
+        printf("everything is up to date\n");
+    }else if(cbs_options.dry_run){
+        printf("%d job(s) would run\n",build->ran_count);
+    }
+    if(build->unchanged_count > 0){
+        printf("%d output(s) came out identical to the last build\n",build->unchanged_count);
+    }
+    return wait_failed == false && cbs_interrupted == false && build->failed_count == 0;
+}
+
+static void build_free(CbsBuild *build){
+    for (int i = 0; i < build->job_count; i++) {
+        CbsJob *job = &build->jobs[i];
+        free(job->command_line);
+        free(job->launch_flags);
+        free(job->display_name);
+        free(job->input_path);
+        free(job->output_path);
+        free(job->depfile_path);
+        free(job->dwo_path);
+        free(job->previous_outputs_ns);
+        free(job->dependents);
+        free(job->dependencies);
+    }
+    free(build->jobs);
+    free(build->ready);
+    free(build->link_jobs);
+    for (int i = 0; i < build->module_count && build->batch_prefixes != NULL; i++) {
+        free(build->batch_prefixes[i]);
+    }
+    free(build->batch_prefixes);
+    map_free(&build->step_jobs,false);
+    for (int i = 0; build->scans != NULL && i < build->module_count; i++) {
+        if(build->scans[i].finished) continue;
+        source_matcher_free(&build->scans[i].matcher);
+        string_list_free(&build->scans[i].pending_directories);
+    }
+    free(build->scans);
+    free(build->configuration_compiler_flags.items);
+    free(build->configuration_linker_flags.items);
+    map_free(&build->records,true);
+    for (uint32_t i = 0; i < build->scanned_files.capacity; i++) {
+        CbsScannedFile *file = build->scanned_files.entries[i].value;
+        if(build->scanned_files.entries[i].key == NULL) continue;
+        string_list_free(&file->quoted_includes);
+        string_list_free(&file->angled_includes);
+    }
+    map_free(&build->scanned_files,true);
+    map_free(&build->resolved_includes,true);
+}
+
+static bool build_records_path(const CbsBuild *build,char *path_buffer){
+    return path_format(path_buffer,"%s%s",build->mode_path,CBS_RECORDS_FILENAME);
+}
+
+//turns the configuration picked by --config, or the first one, into the mode of the build.
+//builds that bring their own mode, like the pgo stages, don't take a configuration
+static bool build_select_configuration(CbsBuild *build,const CbsBuildMode *mode){
+    if(mode != NULL || cbs_configuration_count < 1){
+        if(cbs_options.configuration == NULL) return true;
+        if(mode != NULL) cbs_log_error("--config=%s can't be combined with a [%s] build",cbs_options.configuration,mode->name);
+        else cbs_log_error("--config=%s given but no configurations are set, pass them to cbs_set_configurations",cbs_options.configuration);
+        return false;
+    }
+    const CbsConfiguration *configuration = &cbs_configurations[0];
+    if(cbs_options.configuration != NULL){
+        configuration = NULL;
+        for (int i = 0; i < cbs_configuration_count; i++) {
+            if(strcmp(cbs_configurations[i].name,cbs_options.configuration) == 0) configuration = &cbs_configurations[i];
+        }
+    }
+    if(configuration == NULL){
+        cbs_log_error("configuration [%s] not defined. Defined configurations are as follows...",cbs_options.configuration);
+        for (int i = 0; i < cbs_configuration_count; i++) {
+            printf("%s\n",cbs_configurations[i].name);
+        }
+        return false;
+    }
+    if(string_is_null_empty_or_whitespace(configuration->name)){
+        cbs_log_error("[name] variable in the configuration struct is NULL. Must provide name");
+        return false;
+    }
+
+    //objects, records and caches live in .cbs/config/<name>/, outputs in <output directory>/<name>/
+    snprintf(build->configuration_mode_name,FILE_PATH_MAX,"%s%c%s",CBS_CONFIGURATION_DIRECTORY,FILE_SEPARATOR,configuration->name);
+    append_prefixed_flags(&build->configuration_compiler_flags,&configuration->compiler_flags,"-");
+    append_prefixed_flags(&build->configuration_linker_flags,&configuration->linker_flags,"-l");
+    build->mode.name = build->configuration_mode_name;
+    build->mode.compiler_flags = build->configuration_compiler_flags.items;
+    build->mode.linker_flags = build->configuration_linker_flags.items;
+    build->mode.output_subdirectory = configuration->name;
+    printf("configuration [%s]\n",configuration->name);
+    return true;
+}
+
+//validates the modules and creates the link jobs, nothing runs yet. compiles are added while the
+//sources are scanned, during build_run_jobs or all at once with build_scan_sources
+static bool build_init(CbsBuild *build,const CbsModule *module_array,const int array_length,const CbsBuildMode *mode){
+    memset(build,0,sizeof(CbsBuild));
+    if(module_array == NULL || array_length < 1){
+        cbs_log_error("no modules passed to build");
+        return false;
+    }
+    build->modules = module_array;
+    build->module_count = array_length;
+    if(mode != NULL) build->mode = *mode;
+    if(build_select_configuration(build,mode) == false) return false;
+
+    for (int i = 0; i < array_length; i++) {
+        if(build_validate_module(&module_array[i]) == false){
+            return false;
+        }
+        for (int s = 0; s < module_array[i].steps.length; s++) {
+            if(build_validate_step(&module_array[i].steps.items[s],&module_array[i]) == false) return false;
+        }
+    }
+    uint8_t *visit_states = calloc(array_length,1);
+    for (int i = 0; i < array_length; i++) {
+        if(build_module_has_cycle(build,i,visit_states)){
+            free(visit_states);
+            return false;
+        }
+    }
+    free(visit_states);
+
+    if(try_get_program_path(build->program_path)==false){
+        cbs_log_error("failed to get executable path");
+        return false;
+    }
+    if(path_format(build->state_path,"%s%s%c",build->program_path,CBS_STATE_DIRECTORY,FILE_SEPARATOR) == false) return false;
+    if(build->mode.name == NULL){
+        snprintf(build->mode_path,FILE_PATH_MAX,"%s",build->state_path);
+    }else if(path_format(build->mode_path,"%s%s%c",build->state_path,build->mode.name,FILE_SEPARATOR) == false){
+        return false;
+    }
+    char records_path[FILE_PATH_MAX];
+    if(build_records_path(build,records_path) == false) return false;
+    make_directories_for_file(build->mode_path);
+    if(build->mode.output_directory != NULL){
+        make_directories_for_file(build->mode.output_directory);
+    }
+    records_load(&build->records,records_path);
+
+    for (int i = 0; i < array_length; i++) {
+        for (int s = 0; s < module_array[i].steps.length; s++) {
+            const CbsStep *step = &module_array[i].steps.items[s];
+            void *step_entry = map_get(&build->step_jobs,step->name);
+            if(step_entry == NULL){
+                build_add_step_job(build,step,i);
+                continue;
+            }
+            if(steps_are_same(build->jobs[(int)(intptr_t)step_entry - 1].step,step) == false){
+                cbs_log_error("two different steps are named [%s], modules listing a step by the same name have to agree on "
+                    "its command, inputs, outputs and depfile",step->name);
+                return false;
+            }
+        }
+    }
+
+    build->link_jobs = calloc(array_length,sizeof(int));
+    build->batch_prefixes = calloc(array_length,sizeof(char*));
+    build->scans = calloc(array_length,sizeof(CbsModuleScan));
+    for (int i = 0; i < array_length; i++) {
+        //finished scans own nothing, so build_free skips the modules that never began
+        build->scans[i].finished = true;
+    }
+    for (int i = 0; i < array_length; i++) {
+        build->scans[i].finished = false;
+        if(build_begin_module(build,i) == false){
+            build->scans[i].finished = true;
+            return false;
+        }
+    }
+
+    //a module links after every module it depends on, modules outside the array are assumed to be built
+    for (int i = 0; i < array_length; i++) {
+        const CbsModule *module = &module_array[i];
+        for (int d = 0; d < module->module_dependencies.length; d++) {
+            int dependency_index = build_find_module(build,module->module_dependencies.items[d]);
+            if(dependency_index < 0) continue;
+            build_add_dependency(build,build->link_jobs[i],build->link_jobs[dependency_index]);
+        }
+    }
+    return true;
+}
+
+static bool build_execute(CbsBuild *build){
+    bool success = true;
+    if(cbs_options.changed_from != NULL){
+        success = build_scan_sources(build) && build_select_changed_jobs(build);
+    }
+    for (int i = 0; i < build->job_count; i++) {
+        build_compute_priority(build,i);
+    }
+    if(success){
+        success = build_run_jobs(build);
+    }
+
+    char records_path[FILE_PATH_MAX];
+    if(build_records_path(build,records_path)) records_save(&build->records,records_path);
+
+    if(build->failed_count > 0){
+        cbs_log_error("build failed, %d job(s) failed",build->failed_count);
+    }
+    return success;
+}
+
+bool cbs_modules_build(const CbsModule *module_array,const int array_length){
+    CbsBuild build;
+    bool success = build_init(&build,module_array,array_length,NULL) && build_execute(&build);
+    build_free(&build);
+    return success;
+}
+
+// ==========================================
+// ============ NINJA EXPORT ================
+// ==========================================
+
+#define CBS_NINJA_FILENAME "build.ninja"
+
+//paths in build lines escape spaces, colons and dollars
+static void ninja_append_path(CbsStringBuilder *builder,const CbsBuild *build,const char *path){
+    if(string_starts_with(path,build->program_path)) path = &path[strlen(build->program_path)];
+    for (const char *c = path; *c != '\0'; c++) {
+        if(*c == ' ' || *c == ':' || *c == '$') builder_append_char(builder,'$');
+        builder_append_char(builder,*c);
+    }
+}
+
+//variable values only escape dollars
+static void ninja_append_value(CbsStringBuilder *builder,const char *value){
+    for (const char *c = value; *c != '\0'; c++) {
+        if(*c == '$') builder_append_char(builder,'$');
+        builder_append_char(builder,*c);
+    }
+}
+
+static bool file_has_content(const char *path,const CbsStringBuilder *content){
+    CbsMappedFile mapped;
+    if(file_map(path,&mapped) == false) return false;
+    bool same = mapped.size == content->length && (content->length == 0 || memcmp(mapped.data,content->items,content->length) == 0);
+    file_unmap(&mapped);
+    return same;
+}
+
+//compile and link edges of every job, plus edges that rebuild build.exe from build.c and rerun the export
+//when build.exe or any source folder changes. the file is only rewritten when its content changed
+bool cbs_modules_export_ninja(const CbsModule *module_array,const int array_length,const int argc,const char **argv){
+    CbsBuild build;
+    if(build_init(&build,module_array,array_length,NULL) == false || build_scan_sources(&build) == false){
+        build_free(&build);
+        return false;
+    }
+    char script_path[FILE_PATH_MAX];
+    char executable_path[FILE_PATH_MAX];
+    char ninja_path[FILE_PATH_MAX];
+    char temporary_path[FILE_PATH_MAX];
+    if(path_format(script_path,"%sbuild.c",build.program_path) == false
+    || path_format(executable_path,"%sbuild.exe",build.program_path) == false
+    || path_format(ninja_path,"%s%s",build.program_path,CBS_NINJA_FILENAME) == false
+    || path_format(temporary_path,"%s.tmp",ninja_path) == false){
+        build_free(&build);
+        return false;
+    }
+
+    CbsStringBuilder ninja = {0};
+    builder_append_string(&ninja,"# generated by cbs, edit build.c instead\n");
+    builder_append_string(&ninja,"ninja_required_version = 1.3\n\n");
+    //no "deps = gcc", ninja would delete the depfiles that cbs reads too
+    builder_append_string(&ninja,"rule cbs_compile\n  command = $cmd\n  depfile = $depfile\n  description = CC $in\n\n");
+    builder_append_string(&ninja,"rule cbs_link\n  command = $cmd\n  description = LINK $out\n\n");
+    builder_append_string(&ninja,"rule cbs_step\n  command = $cmd\n  restat = 1\n  description = STEP $name\n\n");
+    builder_append_string(&ninja,"rule cbs_script\n  command = $cmd\n  description = COMPILE build.c\n\n");
+    builder_append_string(&ninja,"rule cbs_export\n  command = $cmd\n  generator = 1\n  description = EXPORT " CBS_NINJA_FILENAME "\n\n");
+
+    char step_path[FILE_PATH_MAX];
+    for (int i = 0; i < build.job_count; i++) {
+        const CbsJob *job = &build.jobs[i];
+        builder_append_string(&ninja,"build ");
+        ninja_append_path(&ninja,&build,job->output_path);
+        if(job->dwo_path != NULL){
+            builder_append_string(&ninja," | ");
+            ninja_append_path(&ninja,&build,job->dwo_path);
+        }
+        for (int o = 1; job->step != NULL && o < job->step->outputs.length; o++) {
+            builder_append_char(&ninja,' ');
+            build_step_path(&build,job->step->outputs.items[o],step_path);
+            ninja_append_path(&ninja,&build,step_path);
+        }
+        if(job->kind == CBS_JOB_COMPILE) builder_append_string(&ninja,": cbs_compile ");
+        else if(job->kind == CBS_JOB_STEP) builder_append_string(&ninja,": cbs_step");
+        else builder_append_string(&ninja,": cbs_link");
+        if(job->kind == CBS_JOB_COMPILE){
+            ninja_append_path(&ninja,&build,job->input_path);
+            //the steps of the module only have to run first
+            bool order_only = false;
+            for (int d = 0; d < job->dependencies_length; d++) {
+                const CbsJob *dependency = &build.jobs[job->dependencies[d]];
+                if(order_only == false){
+                    builder_append_string(&ninja," ||");
+                    order_only = true;
+                }
+                builder_append_char(&ninja,' ');
+                ninja_append_path(&ninja,&build,dependency->output_path);
+            }
+        }else if(job->kind == CBS_JOB_STEP){
+            for (int d = 0; d < job->step->inputs.length; d++) {
+                builder_append_char(&ninja,' ');
+                build_step_path(&build,job->step->inputs.items[d],step_path);
+                ninja_append_path(&ninja,&build,step_path);
+            }
+            builder_append_string(&ninja,"\n  name = ");
+            ninja_append_value(&ninja,job->step->name);
+        }else{
+            //objects are explicit inputs, outputs of other modules only order the link
+            bool implicit = false;
+            for (int d = 0; d < job->dependencies_length; d++) {
+                const CbsJob *dependency = &build.jobs[job->dependencies[d]];
+                if(dependency->kind == CBS_JOB_LINK && implicit == false){
+                    builder_append_string(&ninja," |");
+                    implicit = true;
+                }
+                builder_append_char(&ninja,' ');
+                ninja_append_path(&ninja,&build,dependency->output_path);
+            }
+        }
+        builder_append_string(&ninja,"\n  cmd = ");
+        ninja_append_value(&ninja,job->command_line);
+        if(job->launch_flags != NULL) ninja_append_value(&ninja,job->launch_flags);
+        if(job->depfile_path != NULL){
+            builder_append_string(&ninja,"\n  depfile = ");
+            ninja_append_value(&ninja,job->depfile_path);
+        }
+        builder_append_string(&ninja,"\n");
+    }
+
+    //the same command cbs compile runs, with the compiler of the first module
+    builder_append_string(&ninja,"\nbuild build.exe: cbs_script build.c | build.h\n  cmd = ");
+    CbsStringBuilder command = {0};
+    builder_append_string(&command,module_array[0].compiler);
+    builder_append_char(&command,' ');
+    builder_append_quoted(&command,script_path);
+    builder_append_string(&command,"-o ");
+    builder_append_quoted(&command,executable_path);
+    ninja_append_value(&ninja,command.items);
+
+    //a folder changes when files are added or removed in it, so every folder a source came from is an input
+    builder_append_string(&ninja,"\nbuild " CBS_NINJA_FILENAME ": cbs_export | build.exe");
+    CbsMap folders = {0};
+    char folder[FILE_PATH_MAX];
+    for (int m = 0; m < build.module_count; m++) {
+        snprintf(folder,FILE_PATH_MAX,"%s%s",build.program_path,build.modules[m].source_file_directory);
+        if(map_get(&folders,folder) != NULL) continue;
+        map_put(&folders,folder,(void*)1);
+        builder_append_char(&ninja,' ');
+        ninja_append_path(&ninja,&build,folder);
+    }
+    for (int i = 0; i < build.job_count; i++) {
+        const CbsJob *job = &build.jobs[i];
+        if(job->kind != CBS_JOB_COMPILE) continue;
+        size_t length = (size_t)(path_filename(job->input_path) - job->input_path);
+        if(length < 2) continue;
+        snprintf(folder,FILE_PATH_MAX,"%.*s",(int)(length - 1),job->input_path);
+        if(map_get(&folders,folder) != NULL) continue;
+        map_put(&folders,folder,(void*)1);
+        builder_append_char(&ninja,' ');
+        ninja_append_path(&ninja,&build,folder);
+    }
+    map_free(&folders,false);
+    command.length = 0;
+    builder_append_quoted(&command,executable_path);
+    for (int i = 1; i < argc; i++) {
+        builder_append_quoted(&command,argv[i]);
+    }
+    builder_append_string(&ninja,"\n  cmd = ");
+    ninja_append_value(&ninja,command.items);
+    free(command.items);
+
+    builder_append_string(&ninja,"\n\ndefault");
+    for (int m = 0; m < build.module_count; m++) {
+        builder_append_char(&ninja,' ');
+        ninja_append_path(&ninja,&build,build.jobs[build.link_jobs[m]].output_path);
+    }
+    builder_append_string(&ninja,"\n");
+
+    bool success = true;
+    if(file_has_content(ninja_path,&ninja)){
+        printf("%s is up to date\n",CBS_NINJA_FILENAME);
+    }else{
+        FILE *file = fopen(temporary_path,"wb");
+        success = file != NULL && fwrite(ninja.items,1,ninja.length,file) == ninja.length;
+        if(file != NULL) fclose(file);
+        remove(ninja_path);
+        success = success && rename(temporary_path,ninja_path) == 0;
+        if(success) printf("wrote %s, %d job(s)\n",CBS_NINJA_FILENAME,build.job_count);
+        else cbs_log_error("couldn't write [%s]",ninja_path);
+    }
+    free(ninja.items);
+    build_free(&build);
+    return success;
+}
+
+void cbs_module_compile(CbsModule module){
+    cbs_modules_build(&module,1);
+}
+
+// ==========================================
+// ============ PGO =========================
+// ==========================================
+
+#define CBS_PGO_DIRECTORY "pgo"
+#define CBS_PGO_VERSION "cbs-pgo 1"
+//replaced by the path of the instrumented output in the training command
+#define CBS_PGO_OUTPUT_TOKEN "{output}"
+
+//runs one command to completion and hands back what it wrote, -1 when it couldn't be started
+static int run_command_capture(const char *command_line,CbsStringBuilder *output){
+    CbsProcessPool pool;
+    process_pool_init(&pool,1);
+    int exit_code = -1;
+    if(process_pool_start(&pool,command_line,NULL,NULL)){
+        int slot = process_pool_wait(&pool,-1,&exit_code);
+        if(slot >= 0){
+            *output = process_pool_remove(&pool,slot);
+        }else{
+            process_pool_cancel(&pool);
+            exit_code = -1;
+        }
+    }
+    process_pool_free(&pool);
+    return exit_code;
+}
+
+//runs one command to completion and prints what it wrote, -1 when it couldn't be started
+static int run_command_line(const char *command_line){
+    CbsStringBuilder output = {0};
+    int exit_code = run_command_capture(command_line,&output);
+    if(output.length > 0) fwrite(output.items,1,output.length,stdout);
+    fflush(stdout);
+    free(output.items);
+    return exit_code;
+}
+
+//every file under the directory ending in the extension, the directory must end with a separator
+static void collect_files_with_extension(const char *directory,const char *extension,CbsStringList *files){
+    if(directory_exists(directory) == false) return;
+    const CbsModule filter = {
+        .source_file_extensions = {.items = (const char*[]){extension},.length = 1}
+    };
+    CbsSourceMatcher matcher;
+    source_matcher_init(&matcher,&filter,strlen(directory));
+    char search_path[FILE_PATH_MAX];
+    snprintf(search_path,FILE_PATH_MAX,"%s",directory);
+    add_files_recursive_from_source_directory(search_path,files,&matcher);
+    source_matcher_free(&matcher);
+}
+
+//one hash over the content of every file the compiles read, so a profile can tell it was recorded from other sources
+static uint64_t build_hash_inputs(CbsBuild *build){
+    CbsMap seen = {0};
+    CbsStringList files = {0};
+    char normalized[FILE_PATH_MAX];
+    for (int j = 0; j < build->job_count; j++) {
+        if(build->jobs[j].kind != CBS_JOB_COMPILE) continue;
+        CbsStringList dependencies = {0};
+        build_collect_dependencies(build,j,&dependencies);
+        for (int i = 0; i < dependencies.length; i++) {
+            normalize_path(build->program_path,dependencies.items[i],normalized);
+            if(map_get(&seen,normalized) != NULL) continue;
+            map_put(&seen,normalized,(void*)1);
+            string_list_add(&files,normalized);
+        }
+        string_list_free(&dependencies);
+    }
+    qsort(files.items,files.length,sizeof(char*),compare_strings);
+
+    //paths are hashed relative to the project so moving the checkout keeps the profile
+    size_t root_length = strlen(build->program_path);
+    uint64_t hash = CBS_HASH_SEED;
+    for (int i = 0; i < files.length; i++) {
+        const char *path = files.items[i];
+        const char *relative = string_starts_with(path,build->program_path) ? &path[root_length] : path;
+        hash = hash_bytes(relative,strlen(relative) + 1,hash);
+        CbsMappedFile mapped;
+        if(file_map(path,&mapped)){
+            hash = hash_bytes(mapped.data,mapped.size,hash);
+            file_unmap(&mapped);
+        }
+    }
+    string_list_free(&files);
+    map_free(&seen,false);
+    return hash;
+}
+
+static bool pgo_read_manifest(const char *path,uint64_t *training_hash,uint64_t *input_hash){
+    FILE *file = fopen(path,"r");
+    if(file == NULL) return false;
+    char line[256];
+    unsigned long long training = 0;
+    unsigned long long input = 0;
+    bool valid = fgets(line,sizeof(line),file) != NULL && string_starts_with(line,CBS_PGO_VERSION)
+        && fscanf(file,"%llx %llx",&training,&input) == 2;
+    fclose(file);
+    *training_hash = training;
+    *input_hash = input;
+    return valid;
+}
+
+static bool pgo_write_manifest(const char *path,uint64_t training_hash,uint64_t input_hash){
+    FILE *file = fopen(path,"w");
+    if(file == NULL){
+        cbs_log_error("couldn't write profile manifest [%s]",path);
+        return false;
+    }
+    fprintf(file,"%s\n%llx %llx\n",CBS_PGO_VERSION,(unsigned long long)training_hash,(unsigned long long)input_hash);
+    fclose(file);
+    return true;
+}
+
+//copies the module and every module it depends on into selected, in the order of module_array, returns how many
+static int pgo_select_modules(const CbsModule *module_array,const int array_length,int module_index,CbsModule *selected){
+    bool *wanted = calloc(array_length,sizeof(bool));
+    wanted[module_index] = true;
+    //dependencies of dependencies turn up on the next pass
+    bool added = true;
+    while(added){
+        added = false;
+        for (int i = 0; i < array_length; i++) {
+            if(wanted[i] == false) continue;
+            for (int d = 0; d < module_array[i].module_dependencies.length; d++) {
+                for (int j = 0; j < array_length; j++) {
+                    if(wanted[j] || module_array[j].name == NULL || strcmp(module_array[j].name,module_array[i].module_dependencies.items[d]) != 0) continue;
+                    wanted[j] = true;
+                    added = true;
+                }
+            }
+        }
+    }
+    int count = 0;
+    for (int i = 0; i < array_length; i++) {
+        if(wanted[i]) memcpy(&selected[count++],&module_array[i],sizeof(CbsModule));
+    }
+    free(wanted);
+    return count;
+}
+
+static bool pgo_build(const CbsModule *module_array,const int array_length,const CbsBuildMode *mode,uint64_t *input_hash){
+    CbsBuild build;
+    bool success = build_init(&build,module_array,array_length,mode) && build_execute(&build);
+    if(success && input_hash != NULL){
+        *input_hash = build_hash_inputs(&build);
+    }
+    build_free(&build);
+    return success;
+}
+
+//instrumented build, training run, profile merge and optimized build, see README
+bool cbs_modules_pgo(const CbsModule *module_array,const int array_length,const int argc,const char **argv){
+    if(argc < 3 || argv[2][0] == '-'){
+        cbs_log_error("pgo needs a module name, e.g. \"pgo <module> -- <training command>\"");
+        return false;
+    }
+    cbs_parse_options(argc,argv);
+    const char *module_name = argv[2];
+    bool retrain = false;
+    CbsStringBuilder training_command = {0};
+    for (int i = 3; i < argc; i++) {
+        if(strcmp(argv[i],"--retrain") == 0) retrain = true;
+        if(strcmp(argv[i],"--") != 0) continue;
+        for (int t = i + 1; t < argc; t++) {
+            if(t > i + 1) builder_append_char(&training_command,' ');
+            builder_append_string(&training_command,argv[t]);
+        }
+        break;
+    }
+
+    int module_index = -1;
+    for (int i = 0; i < array_length; i++) {
+        if(module_array[i].name != NULL && strcmp(module_array[i].name,module_name) == 0) module_index = i;
+    }
+    if(module_index < 0){
+        cbs_log_error("module [%s] not found",module_name);
+        free(training_command.items);
+        return false;
+    }
+    const CbsModule *module = &module_array[module_index];
+    CbsCompilerFamily family = compiler_family(module->compiler);
+    if(family == CBS_COMPILER_MSVC){
+        cbs_log_error("pgo isn't supported for [%s], only gcc and clang style compilers",module->compiler);
+        free(training_command.items);
+        return false;
+    }
+
+    char program_path[FILE_PATH_MAX];
+    if(try_get_program_path(program_path) == false){
+        cbs_log_error("failed to get executable path");
+        free(training_command.items);
+        return false;
+    }
+    //the mode name is relative to .cbs, the paths below are absolute
+    char mode_name[FILE_PATH_MAX];
+    char pgo_path[FILE_PATH_MAX];
+    char raw_path[FILE_PATH_MAX];
+    char instrumented_path[FILE_PATH_MAX];
+    char optimized_path[FILE_PATH_MAX];
+    char profile_path[FILE_PATH_MAX];
+    char manifest_path[FILE_PATH_MAX];
+    char instrumented_output[FILE_PATH_MAX];
+    char optimized_output[FILE_PATH_MAX];
+    if(path_format(mode_name,"%s%c%s",CBS_PGO_DIRECTORY,FILE_SEPARATOR,module->name) == false
+    || path_format(pgo_path,"%s%s%c%s%c",program_path,CBS_STATE_DIRECTORY,FILE_SEPARATOR,mode_name,FILE_SEPARATOR) == false
+    || path_format(raw_path,"%sraw%c",pgo_path,FILE_SEPARATOR) == false
+    || path_format(instrumented_path,"%sinstrumented%c",pgo_path,FILE_SEPARATOR) == false
+    || path_format(optimized_path,"%soptimized%c",pgo_path,FILE_SEPARATOR) == false
+    || path_format(profile_path,"%smerged.profdata",pgo_path) == false
+    || path_format(manifest_path,"%sprofile",pgo_path) == false
+    || path_format(instrumented_output,"%s%s",instrumented_path,module->output_file_name_with_extension) == false
+    || path_format(optimized_output,"%s%s",optimized_path,module->output_file_name_with_extension) == false){
+        free(training_command.items);
+        return false;
+    }
+    make_directories_for_file(raw_path);
+
+    //both stages share objects and records, so gcc finds each .gcda under the path of the object it belongs to
+    CbsStringBuilder generate_flags = {0};
+    CbsStringBuilder use_flags = {0};
+    const char *raw_extension = NULL;
+    if(family == CBS_COMPILER_CLANG){
+        raw_extension = ".profraw";
+        builder_append_string(&generate_flags,"-fprofile-instr-generate=\"");
+        builder_append_string(&generate_flags,raw_path);
+        builder_append_string(&generate_flags,"%p.profraw\"");
+        builder_append_string(&use_flags,"-fprofile-instr-use=\"");
+        builder_append_string(&use_flags,profile_path);
+        builder_append_char(&use_flags,'"');
+    }else{
+        raw_extension = ".gcda";
+        builder_append_string(&generate_flags,"-fprofile-generate=\"");
+        builder_append_string(&generate_flags,raw_path);
+        builder_append_string(&generate_flags,"\" -fprofile-update=prefer-atomic");
+        builder_append_string(&use_flags,"-fprofile-use=\"");
+        builder_append_string(&use_flags,raw_path);
+        builder_append_string(&use_flags,"\" -fprofile-partial-training");
+    }
+    const CbsBuildMode generate_mode = {
+        .name = mode_name,
+        .compiler_flags = generate_flags.items,
+        .output_directory = instrumented_path
+    };
+    const CbsBuildMode use_mode = {
+        .name = mode_name,
+        .compiler_flags = use_flags.items,
+        .output_directory = optimized_path,
+        .input_path = manifest_path
+    };
+    //only the module and what it links against, the normal outputs and records of every module are left alone
+    CbsModule *pgo_modules = calloc(array_length,sizeof(CbsModule));
+    int pgo_module_count = pgo_select_modules(module_array,array_length,module_index,pgo_modules);
+
+    bool success = false;
+    uint64_t training_hash = hash_string(training_command.length > 0 ? training_command.items : "");
+    uint64_t recorded_training_hash = 0;
+    uint64_t recorded_input_hash = 0;
+    bool has_profile = pgo_read_manifest(manifest_path,&recorded_training_hash,&recorded_input_hash);
+    if(retrain == false && has_profile){
+        CbsBuild build;
+        bool current = false;
+        if(build_init(&build,pgo_modules,pgo_module_count,&use_mode) && build_scan_sources(&build)){
+            current = recorded_training_hash == training_hash && recorded_input_hash == build_hash_inputs(&build);
+        }
+        build_free(&build);
+        if(current){
+            printf("profile of [%s] is up to date, skipping training\n",module->name);
+            success = pgo_build(pgo_modules,pgo_module_count,&use_mode,NULL);
+            if(success) printf("optimized output is [%s]\n",optimized_output);
+            goto done;
+        }
+        printf("profile of [%s] is stale, the sources or the training command changed since it was recorded\n",module->name);
+    }
+
+    printf("==== pgo 1/4: instrumented build of [%s] ====\n",module->name);
+    //leftovers from older instrumented binaries would be merged into the new profile
+    CbsStringList raw_files = {0};
+    collect_files_with_extension(raw_path,raw_extension,&raw_files);
+    for (int i = 0; i < raw_files.length; i++) {
+        remove(raw_files.items[i]);
+    }
+    string_list_free(&raw_files);
+    remove(manifest_path);
+    uint64_t input_hash = 0;
+    if(pgo_build(pgo_modules,pgo_module_count,&generate_mode,&input_hash) == false) goto done;
+
+    printf("==== pgo 2/4: training ====\n");
+    CbsStringBuilder command = {0};
+    if(training_command.length == 0){
+        builder_append_quoted(&command,instrumented_output);
+    }else{
+        const char *cursor = training_command.items;
+        const char *token;
+        while((token = strstr(cursor,CBS_PGO_OUTPUT_TOKEN)) != NULL){
+            builder_append_bytes(&command,cursor,(size_t)(token - cursor));
+            builder_append_string(&command,instrumented_output);
+            cursor = token + strlen(CBS_PGO_OUTPUT_TOKEN);
+        }
+        builder_append_string(&command,cursor);
+    }
+    printf("%s\n",command.items);
+    fflush(stdout);
+    int exit_code = run_command_line(command.items);
+    free(command.items);
+    if(exit_code != 0){
+        cbs_log_error("training command exited with code %d",exit_code);
+        goto done;
+    }
+
+    printf("==== pgo 3/4: merging profiles ====\n");
+    collect_files_with_extension(raw_path,raw_extension,&raw_files);
+    if(raw_files.length == 0){
+        cbs_log_error("training didn't write any %s files to [%s]",raw_extension,raw_path);
+        goto done;
+    }
+    //gcc adds every run into the .gcda of each object itself, clang's raw profiles need llvm-profdata
+    if(family == CBS_COMPILER_CLANG){
+        char tool[FILE_PATH_MAX];
+        llvm_tool_for_compiler(module->compiler,"llvm-profdata",tool);
+        CbsStringBuilder merge = {0};
+        builder_append_string(&merge,tool);
+        builder_append_string(&merge," merge -o ");
+        builder_append_quoted(&merge,profile_path);
+        for (int i = 0; i < raw_files.length; i++) {
+            builder_append_quoted(&merge,raw_files.items[i]);
+        }
+        exit_code = run_command_line(merge.items);
+        free(merge.items);
+        if(exit_code != 0){
+            cbs_log_error("[%s] exited with code %d",tool,exit_code);
+            string_list_free(&raw_files);
+            goto done;
+        }
+    }
+    printf("%d profile file(s)\n",raw_files.length);
+    string_list_free(&raw_files);
+    if(pgo_write_manifest(manifest_path,training_hash,input_hash) == false) goto done;
+
+    printf("==== pgo 4/4: optimized build of [%s] ====\n",module->name);
+    success = pgo_build(pgo_modules,pgo_module_count,&use_mode,NULL);
+    if(success) printf("optimized output is [%s]\n",optimized_output);
+
+done:
+    free(pgo_modules);
+    free(generate_flags.items);
+    free(use_flags.items);
+    free(training_command.items);
+    return success;
+}
+
+// ==========================================
+// ============ TOOLCHAIN PROBES ============
+// ==========================================
+
+#define CBS_PROBE_DIRECTORY "probe"
+#define CBS_PROBES_FILENAME "probes"
+#define CBS_TOOLCHAINS_FILENAME "toolchains"
+#define CBS_PROBES_VERSION "cbs-probes 1"
+
+//what the toolchain was last time, so its version and hash are only redone once the binary changes
+typedef struct CbsToolchain{
+    int64_t modified_ns;
+    uint64_t size;
+    uint64_t key;
+}CbsToolchain;
+
+static void toolchains_load(CbsMap *toolchains,const char *path){
+    FILE *file = fopen(path,"r");
+    if(file == NULL) return;
+    char line[FILE_PATH_MAX + 64];
+    if(fgets(line,sizeof(line),file) == NULL || string_starts_with(line,CBS_PROBES_VERSION) == false){
+        fclose(file);
+        return;
+    }
+    while(fgets(line,sizeof(line),file) != NULL){
+        long long modified_ns = 0;
+        unsigned long long size = 0;
+        unsigned long long key = 0;
+        int path_offset = 0;
+        if(sscanf(line,"%lld %llu %llx %n",&modified_ns,&size,&key,&path_offset) != 3 || path_offset == 0) continue;
+        char *program_path = &line[path_offset];
+        program_path[strcspn(program_path,"\r\n")] = '\0';
+        CbsToolchain *toolchain = calloc(1,sizeof(CbsToolchain));
+        toolchain->modified_ns = modified_ns;
+        toolchain->size = size;
+        toolchain->key = key;
+        map_put(toolchains,program_path,toolchain);
+    }
+    fclose(file);
+}
+
+static void toolchains_save(const CbsMap *toolchains,const char *path){
+    FILE *file = fopen(path,"w");
+    if(file == NULL) return;
+    fprintf(file,"%s\n",CBS_PROBES_VERSION);
+    for (uint32_t i = 0; i < toolchains->capacity; i++) {
+        const CbsMapEntry *entry = &toolchains->entries[i];
+        if(entry->key == NULL) continue;
+        const CbsToolchain *toolchain = entry->value;
+        fprintf(file,"%lld %llu %llx %s\n",(long long)toolchain->modified_ns,(unsigned long long)toolchain->size,(unsigned long long)toolchain->key,entry->key);
+    }
+    fclose(file);
+}
+
+//hash of the resolved path, the version it prints and the binary itself, 0 when the compiler can't be found
+static uint64_t probe_toolchain_key(const char *compiler,const char *state_path){
+    const char *program_path = find_program(compiler);
+    if(program_path == NULL){
+        cbs_log_error("compiler [%s] not found",compiler);
+        return 0;
+    }
+    int64_t modified_ns = 0;
+    try_get_file_modified_time(program_path,&modified_ns);
+    uint64_t size = get_file_size(program_path);
+
+    char toolchains_path[FILE_PATH_MAX];
+    if(path_format(toolchains_path,"%s%s",state_path,CBS_TOOLCHAINS_FILENAME) == false) return 0;
+    CbsMap toolchains = {0};
+    toolchains_load(&toolchains,toolchains_path);
+    CbsToolchain *toolchain = map_get(&toolchains,program_path);
+    if(toolchain != NULL && toolchain->modified_ns == modified_ns && toolchain->size == size){
+        uint64_t key = toolchain->key;
+        map_free(&toolchains,true);
+        return key;
+    }
+
+    //cl prints its version when it's run without arguments
+    CbsStringBuilder command = {0};
+    builder_append_quoted(&command,program_path);
+    if(compiler_family(compiler) != CBS_COMPILER_MSVC) builder_append_string(&command,"--version");
+    CbsStringBuilder version = {0};
+    run_command_capture(command.items,&version);
+    free(command.items);
+
+    uint64_t key = hash_string(program_path);
+    if(version.length > 0) key = hash_bytes(version.items,version.length,key);
+    CbsMappedFile mapped;
+    if(file_map(program_path,&mapped)){
+        key = hash_bytes(mapped.data,mapped.size,key);
+        file_unmap(&mapped);
+    }
+    free(version.items);
+
+    if(toolchain == NULL){
+        toolchain = calloc(1,sizeof(CbsToolchain));
+        map_put(&toolchains,program_path,toolchain);
+    }
+    toolchain->modified_ns = modified_ns;
+    toolchain->size = size;
+    toolchain->key = key;
+    toolchains_save(&toolchains,toolchains_path);
+    map_free(&toolchains,true);
+    return key;
+}
+
+static void probes_load(CbsMap *results,const char *path){
+    FILE *file = fopen(path,"r");
+    if(file == NULL) return;
+    char line[FILE_PATH_MAX + 64];
+    if(fgets(line,sizeof(line),file) == NULL || string_starts_with(line,CBS_PROBES_VERSION) == false){
+        fclose(file);
+        return;
+    }
+    while(fgets(line,sizeof(line),file) != NULL){
+        int found = 0;
+        int key_offset = 0;
+        if(sscanf(line,"%d %n",&found,&key_offset) != 1 || key_offset == 0) continue;
+        char *key = &line[key_offset];
+        key[strcspn(key,"\r\n")] = '\0';
+        //values are never NULL in a map
+        map_put(results,key,found ? (void*)2 : (void*)1);
+    }
+    fclose(file);
+}
+
+static void probes_save(const CbsMap *results,const char *path){
+    FILE *file = fopen(path,"w");
+    if(file == NULL){
+        cbs_log_error("couldn't write probe results to [%s]",path);
+        return;
+    }
+    fprintf(file,"%s\n",CBS_PROBES_VERSION);
+    for (uint32_t i = 0; i < results->capacity; i++) {
+        const CbsMapEntry *entry = &results->entries[i];
+        if(entry->key == NULL) continue;
+        fprintf(file,"%d %s\n",entry->value == (void*)2 ? 1 : 0,entry->key);
+    }
+    fclose(file);
+}
+
+//writes the test program of the probe and returns the command that checks it, the probe passes when it exits with 0
+static char* probe_command(const char *compiler,const CbsProbe *probe,const char *file_stem){
+    bool msvc = compiler_family(compiler) == CBS_COMPILER_MSVC;
+    char source_path[FILE_PATH_MAX];
+    char output_path[FILE_PATH_MAX];
+    const char *output_extension = probe->kind == CBS_PROBE_FUNCTION ? ".exe" : msvc ? ".obj" : ".o";
+    if(path_format(source_path,"%s.c",file_stem) == false || path_format(output_path,"%s%s",file_stem,output_extension) == false){
+        return NULL;
+    }
+    FILE *file = fopen(source_path,"w");
+    if(file == NULL) return NULL;
+    if(probe->kind == CBS_PROBE_HEADER){
+        fprintf(file,"#include <%s>\n",probe->name);
+    }else if(probe->kind == CBS_PROBE_FUNCTION){
+        //the autoconf way, a wrong prototype on purpose so only the linker decides
+        fprintf(file,"char %s(void);\nint main(void){return (int)%s();}\n",probe->name,probe->name);
+    }
+    if(probe->kind != CBS_PROBE_FUNCTION){
+        fprintf(file,"int main(void){return 0;}\n");
+    }
+    fclose(file);
+
+    //the binary the toolchain key was made from, not whatever the name finds later
+    CbsStringBuilder command = {0};
+    builder_append_program(&command,compiler);
+    if(msvc) builder_append_string(&command,"/nologo ");
+    if(probe->kind == CBS_PROBE_FLAG){
+        //unknown flags are only warnings for some compilers
+        builder_append_string(&command,msvc ? "/WX " : "-Werror ");
+        builder_append_string(&command,probe->name);
+        builder_append_char(&command,' ');
+    }
+    if(probe->kind != CBS_PROBE_FUNCTION){
+        builder_append_string(&command,"-c ");
+    }
+    builder_append_quoted(&command,source_path);
+    if(probe->kind == CBS_PROBE_FUNCTION){
+        builder_append_string(&command,msvc ? "/Fe" : "-o ");
+    }else{
+        builder_append_string(&command,msvc ? "/Fo" : "-o ");
+    }
+    builder_append_quoted(&command,output_path);
+    return command.items;
+}
+
+static void probe_remove_files(const char *file_stem){
+    const char *extensions[] = {".c",".o",".obj",".exe"};
+    char path[FILE_PATH_MAX];
+    for (int i = 0; i < 4; i++) {
+        if(path_format(path,"%s%s",file_stem,extensions[i])) remove(path);
+    }
+}
+
+//sets found on every probe. results are cached in .cbs/probes for the exact compiler binary, so only
+//probes that are new or that were made with another compiler run, all at the same time.
+//false when a probe couldn't run, its found stays false and it isn't cached, so it's not the same as unsupported
+bool cbs_probe(const char *compiler,CbsProbe *probe_array,const int array_length){
+    for (int i = 0; i < array_length; i++) {
+        probe_array[i].found = false;
+    }
+    char program_path[FILE_PATH_MAX];
+    if(try_get_program_path(program_path) == false){
+        cbs_log_error("failed to get executable path");
+        return false;
+    }
+    char state_path[FILE_PATH_MAX];
+    char probe_path[FILE_PATH_MAX];
+    char results_path[FILE_PATH_MAX];
+    if(path_format(state_path,"%s%s%c",program_path,CBS_STATE_DIRECTORY,FILE_SEPARATOR) == false
+    || path_format(probe_path,"%s%s%c",state_path,CBS_PROBE_DIRECTORY,FILE_SEPARATOR) == false
+    || path_format(results_path,"%s%s",state_path,CBS_PROBES_FILENAME) == false){
+        return false;
+    }
+    make_directories_for_file(probe_path);
+
+    uint64_t toolchain_key = probe_toolchain_key(compiler,state_path);
+    if(toolchain_key == 0) return false;
+
+    CbsMap results = {0};
+    probes_load(&results,results_path);
+
+    char **keys = calloc(array_length,sizeof(char*));
+    int *pending = calloc(array_length,sizeof(int));
+    int pending_count = 0;
+    for (int i = 0; i < array_length; i++) {
+        CbsStringBuilder key = {0};
+        char prefix[64];
+        snprintf(prefix,sizeof(prefix),"%016llx %d ",(unsigned long long)toolchain_key,(int)probe_array[i].kind);
+        builder_append_string(&key,prefix);
+        builder_append_string(&key,probe_array[i].name);
+        keys[i] = key.items;
+        void *result = map_get(&results,keys[i]);
+        if(result != NULL) probe_array[i].found = result == (void*)2;
+        else pending[pending_count++] = i;
+    }
+
+    bool success = true;
+    if(pending_count > 0){
+        printf("checking %d feature(s) of [%s]\n",pending_count,compiler);
+        fflush(stdout);
+        int job_limit = cbs_options.job_count > 0 ? cbs_options.job_count : processor_count();
+        if(job_limit > CBS_MAX_PARALLEL_PROCESSES) job_limit = CBS_MAX_PARALLEL_PROCESSES;
+        CbsProcessPool pool;
+        process_pool_init(&pool,job_limit);
+        int *running_probes = calloc(job_limit,sizeof(int));
+        char file_stem[FILE_PATH_MAX];
+        int next = 0;
+        bool stopped = false;
+        while(stopped == false && (next < pending_count || pool.count > 0)){
+            while(pool.count < job_limit && next < pending_count){
+                int probe_index = pending[next++];
+                char *command = NULL;
+                if(path_format(file_stem,"%s%016llx",probe_path,(unsigned long long)hash_string(keys[probe_index]))){
+                    command = probe_command(compiler,&probe_array[probe_index],file_stem);
+                }
+                bool started = command != NULL && process_pool_start(&pool,command,probe_path,NULL);
+                free(command);
+                if(started){
+                    running_probes[pool.count - 1] = probe_index;
+                }else{
+                    cbs_log_error("couldn't run the probe for [%s] with [%s]",probe_array[probe_index].name,compiler);
+                    probe_remove_files(file_stem);
+                    success = false;
+                }
+            }
+            if(pool.count == 0) continue;
+
+            int exit_code = 1;
+            int slot = process_pool_wait(&pool,-1,&exit_code);
+            if(slot < 0){
+                stopped = true;
+                success = false;
+                continue;
+            }
+            int probe_index = running_probes[slot];
+            CbsStringBuilder output = process_pool_remove(&pool,slot);
+            free(output.items);
+            running_probes[slot] = running_probes[pool.count];
+            probe_array[probe_index].found = exit_code == 0;
+            map_put(&results,keys[probe_index],exit_code == 0 ? (void*)2 : (void*)1);
+            //the stem fit when the probe started
+            path_format(file_stem,"%s%016llx",probe_path,(unsigned long long)hash_string(keys[probe_index]));
+            probe_remove_files(file_stem);
+        }
+        //interrupted probes stay unknown and run again next time
+        process_pool_cancel(&pool);
+        process_pool_free(&pool);
+        free(running_probes);
+        probes_save(&results,results_path);
+    }
+
+    for (int i = 0; i < array_length; i++) {
+        free(keys[i]);
+    }
+    free(keys);
+    free(pending);
+    map_free(&results,false);
+    return success;
+}
+
+static bool probe_one(const char *compiler,CbsProbeKind kind,const char *name){
+    CbsProbe probe = {.kind = kind,.name = name};
+    cbs_probe(compiler,&probe,1);
+    return probe.found;
+}
+
+bool cbs_compiler_supports_flag(const char *compiler,const char *flag){
+    return probe_one(compiler,CBS_PROBE_FLAG,flag);
+}
+
+bool cbs_has_header(const char *compiler,const char *header){
+    return probe_one(compiler,CBS_PROBE_HEADER,header);
+}
+
+bool cbs_check_function(const char *compiler,const char *function){
+    return probe_one(compiler,CBS_PROBE_FUNCTION,function);
+}
+
+// ==========================================
+// ============ TESTS =======================
+// ==========================================
+
+#define CBS_TEST_RECORDS_FILENAME "test-records"
+#define CBS_TEST_LOG_DIRECTORY "test"
+#define CBS_TEST_DEFAULT_TIMEOUT_SECONDS 600
+
+typedef struct CbsTest{
+    const CbsModule *module;
+    const char *executable_path;
+    //duration of the last run, only known when measured is set
+    uint64_t previous_ms;
+    bool measured;
+    uint64_t start_ms;
+    uint64_t deadline_ms;
+    bool timed_out;
+}CbsTest;
+
+//tests that never ran go first since they could be the slowest, then the slowest first
+static int compare_tests(const void *a,const void *b){
+    const CbsTest *test_a = a;
+    const CbsTest *test_b = b;
+    if(test_a->measured != test_b->measured) return test_a->measured ? 1 : -1;
+    if(test_a->previous_ms != test_b->previous_ms) return test_a->previous_ms > test_b->previous_ms ? -1 : 1;
+    return strcmp(test_a->module->name,test_b->module->name);
+}
+
+static void test_write_log(const char *log_directory,const CbsTest *test,const CbsStringBuilder *output){
+    char log_path[FILE_PATH_MAX];
+    if(path_format(log_path,"%s%s.log",log_directory,test->module->name) == false) return;
+    FILE *file = fopen(log_path,"wb");
+    if(file == NULL){
+        cbs_log_error("couldn't write test log [%s]",log_path);
+        return;
+    }
+    if(output->length > 0) fwrite(output->items,1,output->length,file);
+    fclose(file);
+}
+
+//builds the modules, then runs the output of every module marked is_test, as many at a time as there are jobs.
+//each test starts in the folder of the build script, its output goes to .cbs/test/<name>.log and is
+//printed when it fails. with --shard=i/N only every Nth test starting at the ith runs
+bool cbs_modules_test(const CbsModule *module_array,const int array_length){
+    int shard_count = cbs_options.shard_count > 0 ? cbs_options.shard_count : 1;
+    int shard_index = cbs_options.shard_count > 0 ? cbs_options.shard_index - 1 : 0;
+    if(shard_index < 0 || shard_index >= shard_count){
+        cbs_log_error("shard %d/%d doesn't exist, shards count from 1",shard_index + 1,shard_count);
+        return false;
+    }
+
+    CbsBuild build;
+    if(build_init(&build,module_array,array_length,NULL) == false || build_execute(&build) == false){
+        build_free(&build);
+        return false;
+    }
+
+    char records_path[FILE_PATH_MAX];
+    char log_directory[FILE_PATH_MAX];
+    if(path_format(records_path,"%s%s",build.mode_path,CBS_TEST_RECORDS_FILENAME) == false
+    || path_format(log_directory,"%s%s%c",build.mode_path,CBS_TEST_LOG_DIRECTORY,FILE_SEPARATOR) == false){
+        build_free(&build);
+        return false;
+    }
+    CbsMap records = {0};
+    records_load(&records,records_path);
+
+    //shards are picked in array order so every machine agrees on them
+    CbsTest *tests = calloc(array_length,sizeof(CbsTest));
+    int test_count = 0;
+    int test_number = 0;
+    for (int i = 0; i < array_length; i++) {
+        if(module_array[i].is_test == false) continue;
+        if(test_number++ % shard_count != shard_index) continue;
+        CbsTest *test = &tests[test_count++];
+        test->module = &module_array[i];
+        test->executable_path = build.jobs[build.link_jobs[i]].output_path;
+        const CbsRecord *record = map_get(&records,module_array[i].name);
+        if(record != NULL){
+            test->previous_ms = record->duration_ms;
+            test->measured = true;
+        }
+    }
+    qsort(tests,test_count,sizeof(CbsTest),compare_tests);
+
+    if(cbs_options.dry_run){
+        for (int i = 0; i < test_count; i++) {
+            printf("[test] %s\n",tests[i].executable_path);
+        }
+        free(tests);
+        map_free(&records,true);
+        build_free(&build);
+        return true;
+    }
+
+    make_directories_for_file(log_directory);
+
+    int job_limit = cbs_options.job_count > 0 ? cbs_options.job_count : processor_count();
+    if(job_limit > CBS_MAX_PARALLEL_PROCESSES) job_limit = CBS_MAX_PARALLEL_PROCESSES;
+    CbsProcessPool pool;
+    process_pool_init(&pool,job_limit);
+    int *running_tests = calloc(job_limit,sizeof(int));
+    int next_test = 0;
+    int finished_count = 0;
+    int failed_count = 0;
+    int timed_out_count = 0;
+    bool wait_failed = false;
+
+    while(finished_count < test_count && cbs_interrupted == false){
+        if(cbs_options.fail_fast && failed_count + timed_out_count > 0) break;
+        while(pool.count < job_limit && next_test < test_count){
+            CbsTest *test = &tests[next_test];
+            CbsStringBuilder command = {0};
+            builder_append_char(&command,'"');
+            builder_append_string(&command,test->executable_path);
+            builder_append_char(&command,'"');
+            int timeout_seconds = test->module->test_timeout_seconds > 0 ? test->module->test_timeout_seconds : CBS_TEST_DEFAULT_TIMEOUT_SECONDS;
+            test->start_ms = time_now_ms();
+            test->deadline_ms = test->start_ms + (uint64_t)timeout_seconds * 1000;
+            bool started = process_pool_start(&pool,command.items,build.program_path,NULL);
+            free(command.items);
+            if(started){
+                running_tests[pool.count - 1] = next_test;
+            }else{
+                finished_count++;
+                failed_count++;
+                printf("[%d/%d] FAIL %s (couldn't start)\n",finished_count,test_count,test->module->name);
+            }
+            next_test++;
+        }
+        if(pool.count == 0) continue;
+
+        //wake up in time for the nearest deadline
+        uint64_t now_ms = time_now_ms();
+        uint64_t nearest_deadline_ms = UINT64_MAX;
+        for (int slot = 0; slot < pool.count; slot++) {
+            const CbsTest *test = &tests[running_tests[slot]];
+            if(test->timed_out == false && test->deadline_ms < nearest_deadline_ms) nearest_deadline_ms = test->deadline_ms;
+        }
+        int timeout_ms = -1;
+        if(nearest_deadline_ms != UINT64_MAX){
+            uint64_t remaining_ms = nearest_deadline_ms > now_ms ? nearest_deadline_ms - now_ms : 0;
+            timeout_ms = remaining_ms > 0x7fffffff ? 0x7fffffff : (int)remaining_ms;
+        }
+
+        int exit_code = 0;
+        int slot = process_pool_wait(&pool,timeout_ms,&exit_code);
+        if(slot == -2){
+            wait_failed = true;
+            break;
+        }
+        if(slot == -3) break;
+        if(slot == -1){
+            now_ms = time_now_ms();
+            for (int s = 0; s < pool.count; s++) {
+                CbsTest *test = &tests[running_tests[s]];
+                if(test->timed_out || now_ms < test->deadline_ms) continue;
+                test->timed_out = true;
+                process_pool_kill(&pool,s);
+            }
+            continue;
+        }
+
+        CbsTest *test = &tests[running_tests[slot]];
+        CbsStringBuilder output = process_pool_remove(&pool,slot);
+        running_tests[slot] = running_tests[pool.count];
+        uint64_t duration_ms = time_now_ms() - test->start_ms;
+        record_get_or_create(&records,test->module->name)->duration_ms = duration_ms;
+        test_write_log(log_directory,test,&output);
+        finished_count++;
+
+        if(test->timed_out){
+            timed_out_count++;
+            printf("[%d/%d] TIMEOUT %s (%llu ms)\n",finished_count,test_count,test->module->name,(unsigned long long)duration_ms);
+        }else if(exit_code != 0){
+            failed_count++;
+            printf("[%d/%d] FAIL %s (exit code %d, %llu ms)\n",finished_count,test_count,test->module->name,exit_code,(unsigned long long)duration_ms);
+        }else{
+            printf("[%d/%d] PASS %s (%llu ms)\n",finished_count,test_count,test->module->name,(unsigned long long)duration_ms);
+        }
+        if((test->timed_out || exit_code != 0) && output.length > 0){
+            fwrite(output.items,1,output.length,stdout);
+            if(output.items[output.length - 1] != '\n') putchar('\n');
+        }
+        fflush(stdout);
+        free(output.items);
+    }
+
+    if(pool.count > 0 || next_test < test_count){
+        if(cbs_interrupted) cbs_log_error("interrupted, %d running test(s) killed",pool.count);
+        else if(wait_failed) cbs_log_error("stopped waiting on tests, %d running test(s) killed",pool.count);
+        else cbs_log_error("stopped after the first failure, %d running test(s) killed",pool.count);
+    }
+    process_pool_cancel(&pool);
+    process_pool_free(&pool);
+    free(running_tests);
+
+    records_save(&records,records_path);
+    map_free(&records,true);
+
+    int passed_count = finished_count - failed_count - timed_out_count;
+    printf("%d test(s) passed, %d failed, %d timed out\n",passed_count,failed_count,timed_out_count);
+    bool success = passed_count == test_count;
+    free(tests);
+    build_free(&build);
+    return success;
+}
+
+// ==========================================
+// ============ BENCHMARKS ==================
+// ==========================================
+
+#define CBS_BENCH_DIRECTORY "bench"
+#define CBS_BENCH_BASELINE_FILENAME "bench-baseline"
+#define CBS_BENCH_BASELINE_VERSION "cbs-bench 1"
+#define CBS_BENCH_DEFAULT_RUNS 10
+#define CBS_BENCH_DEFAULT_WARMUP_RUNS 1
+#define CBS_BENCH_DEFAULT_THRESHOLD_PERCENT 5.0
+
+//every time measured for one benchmark of a module, in nanoseconds
+typedef struct CbsBenchSamples{
+    double *items;
+    int length;
+    int capacity;
+}CbsBenchSamples;
+
+//names in the order the benchmark printed them, so the report follows the program
+typedef struct CbsBenchResults{
+    CbsStringList names;
+    CbsMap samples;
+}CbsBenchResults;
+
+static void bench_results_add(CbsBenchResults *results,const char *name,double ns){
+    CbsBenchSamples *samples = map_get(&results->samples,name);
+    if(samples == NULL){
+        samples = calloc(1,sizeof(CbsBenchSamples));
+        map_put(&results->samples,name,samples);
+        string_list_add(&results->names,name);
+    }
+    if(samples->length == samples->capacity){
+        samples->capacity = samples->capacity == 0 ? 16 : samples->capacity * 2;
+        samples->items = realloc(samples->items,sizeof(double) * samples->capacity);
+    }
+    samples->items[samples->length++] = ns;
+}
+
+static void bench_results_free(CbsBenchResults *results){
+    for (uint32_t i = 0; i < results->samples.capacity; i++) {
+        if(results->samples.entries[i].key == NULL) continue;
+        free(((CbsBenchSamples*)results->samples.entries[i].value)->items);
+    }
+    map_free(&results->samples,true);
+    string_list_free(&results->names);
+}
+
+//0 for a unit that isn't known
+static double bench_unit_to_ns(const char *unit){
+    if(strcmp(unit,"ns") == 0) return 1;
+    if(strcmp(unit,"us") == 0) return 1e3;
+    if(strcmp(unit,"ms") == 0) return 1e6;
+    if(strcmp(unit,"s") == 0) return 1e9;
+    return 0;
+}
+
+//"bench <name> <time> <unit>" lines, everything else the program prints is ignored
+static int bench_parse_lines(const CbsStringBuilder *output,CbsBenchResults *results){
+    int parsed_count = 0;
+    size_t start = 0;
+    while(start < output->length){
+        const char *line = &output->items[start];
+        const char *newline = memchr(line,'\n',output->length - start);
+        size_t length = newline != NULL ? (size_t)(newline - line) : output->length - start;
+        start += length + 1;
+        if(length < 6 || length > 511 || strncmp(line,"bench ",6) != 0) continue;
+
+        char copy[512];
+        memcpy(copy,line,length);
+        copy[length] = '\0';
+        char name[512];
+        char unit[16];
+        double value = 0;
+        if(sscanf(copy,"bench %511s %lf %15s",name,&value,unit) != 3) continue;
+        double scale = bench_unit_to_ns(unit);
+        if(scale == 0) continue;
+        bench_results_add(results,name,value * scale);
+        parsed_count++;
+    }
+    return parsed_count;
+}
+
+//where the value of "key" starts inside [start,end), NULL when the object doesn't have it
+static const char* json_find_value(const char *start,const char *end,const char *key){
+    size_t key_length = strlen(key);
+    for (const char *c = start; c + key_length + 2 < end; c++) {
+        if(c[0] != '"' || strncmp(&c[1],key,key_length) != 0 || c[key_length + 1] != '"') continue;
+        const char *value = &c[key_length + 2];
+        while(value < end && (isspace((unsigned char)*value) || *value == ':')) value++;
+        return value < end ? value : NULL;
+    }
+    return NULL;
+}
+
+static bool json_string_value(const char *start,const char *end,const char *key,char *buffer,size_t buffer_size){
+    const char *value = json_find_value(start,end,key);
+    if(value == NULL || *value != '"') return false;
+    size_t length = 0;
+    for (value++; value < end && *value != '"' && length + 1 < buffer_size; value++) {
+        if(*value == '\\' && value + 1 < end) value++;
+        buffer[length++] = *value;
+    }
+    buffer[length] = '\0';
+    return true;
+}
+
+//end of the object or array starting at c, strings are skipped so braces inside names don't count
+static const char* json_skip_container(const char *c,const char *end){
+    int depth = 0;
+    bool in_string = false;
+    for (; c < end; c++) {
+        if(in_string){
+            if(*c == '\\') c++;
+            else if(*c == '"') in_string = false;
+        }else if(*c == '"'){
+            in_string = true;
+        }else if(*c == '{' || *c == '['){
+            depth++;
+        }else if(*c == '}' || *c == ']'){
+            if(--depth == 0) return c + 1;
+        }
+    }
+    return end;
+}
+
+//the "benchmarks" array of google benchmark's json, aggregates like the mean of repetitions are left out
+static int bench_parse_google_json(const char *path,CbsBenchResults *results){
+    CbsMappedFile mapped;
+    if(file_map(path,&mapped) == false) return 0;
+    const char *data = mapped.data;
+    const char *end = data + mapped.size;
+    int parsed_count = 0;
+    const char *array = json_find_value(data,end,"benchmarks");
+    if(array != NULL && *array == '['){
+        const char *array_end = json_skip_container(array,end);
+        const char *c = array + 1;
+        while(c < array_end){
+            const char *object = memchr(c,'{',(size_t)(array_end - c));
+            if(object == NULL) break;
+            const char *object_end = json_skip_container(object,array_end);
+            c = object_end;
+
+            char name[512];
+            char run_type[32] = "";
+            char unit[16] = "ns";
+            json_string_value(object,object_end,"run_type",run_type,sizeof(run_type));
+            json_string_value(object,object_end,"time_unit",unit,sizeof(unit));
+            const char *time = json_find_value(object,object_end,"real_time");
+            if(strcmp(run_type,"aggregate") == 0 || time == NULL) continue;
+            if(json_string_value(object,object_end,"name",name,sizeof(name)) == false) continue;
+            double scale = bench_unit_to_ns(unit);
+            if(scale == 0) continue;
+            bench_results_add(results,name,strtod(time,NULL) * scale);
+            parsed_count++;
+        }
+    }
+    file_unmap(&mapped);
+    return parsed_count;
+}
+
+static int compare_doubles(const void *a,const void *b){
+    double double_a = *(const double*)a;
+    double double_b = *(const double*)b;
+    return double_a < double_b ? -1 : double_a > double_b;
+}
+
+static double bench_median(CbsBenchSamples *samples){
+    qsort(samples->items,samples->length,sizeof(double),compare_doubles);
+    int middle = samples->length / 2;
+    if(samples->length % 2 == 1) return samples->items[middle];
+    return (samples->items[middle - 1] + samples->items[middle]) / 2;
+}
+
+static void bench_format_time(double ns,char *buffer,size_t buffer_size){
+    if(ns >= 1e9) snprintf(buffer,buffer_size,"%.3f s",ns / 1e9);
+    else if(ns >= 1e6) snprintf(buffer,buffer_size,"%.3f ms",ns / 1e6);
+    else if(ns >= 1e3) snprintf(buffer,buffer_size,"%.3f us",ns / 1e3);
+    else snprintf(buffer,buffer_size,"%.1f ns",ns);
+}
+
+//"<median ns> <module>/<benchmark>" lines, the values of the baseline map are heap doubles
+static void bench_baseline_load(CbsMap *baseline,const char *path){
+    FILE *file = fopen(path,"r");
+    if(file == NULL) return;
+    char line[FILE_PATH_MAX + 64];
+    if(fgets(line,sizeof(line),file) == NULL || string_starts_with(line,CBS_BENCH_BASELINE_VERSION) == false){
+        fclose(file);
+        return;
+    }
+    while(fgets(line,sizeof(line),file) != NULL){
+        double median_ns = 0;
+        int key_offset = 0;
+        if(sscanf(line,"%lf %n",&median_ns,&key_offset) != 1 || key_offset == 0) continue;
+        char *key = &line[key_offset];
+        key[strcspn(key,"\r\n")] = '\0';
+        if(key[0] == '\0') continue;
+        double *value = map_get(baseline,key);
+        if(value == NULL){
+            value = malloc(sizeof(double));
+            map_put(baseline,key,value);
+        }
+        *value = median_ns;
+    }
+    fclose(file);
+}
+
+static bool bench_baseline_save(const CbsMap *baseline,const char *path){
+    char temporary_path[FILE_PATH_MAX];
+    if(path_format(temporary_path,"%s.tmp",path) == false) return false;
+    FILE *file = fopen(temporary_path,"w");
+    if(file == NULL){
+        cbs_log_error("couldn't write the benchmark baseline to [%s]",temporary_path);
+        return false;
+    }
+    //sorted so the file diffs well when it's kept in version control
+    CbsStringList keys = {0};
+    for (uint32_t i = 0; i < baseline->capacity; i++) {
+        if(baseline->entries[i].key != NULL) string_list_add(&keys,baseline->entries[i].key);
+    }
+    qsort(keys.items,keys.length,sizeof(char*),compare_strings);
+    fprintf(file,"%s\n",CBS_BENCH_BASELINE_VERSION);
+    for (int i = 0; i < keys.length; i++) {
+        fprintf(file,"%.17g %s\n",*(double*)map_get(baseline,keys.items[i]),keys.items[i]);
+    }
+    string_list_free(&keys);
+    fclose(file);
+    remove(path);
+    if(rename(temporary_path,path) != 0){
+        cbs_log_error("couldn't replace the benchmark baseline at [%s]",path);
+        return false;
+    }
+    return true;
+}
+
+//one run of the benchmark on its own, returns the exit code, -1 when it couldn't start or was interrupted
+static int bench_run_once(const char *command_line,const char *working_directory,CbsStringBuilder *output,uint64_t *duration_ns){
+    CbsProcessPool pool;
+    process_pool_init(&pool,1);
+    int exit_code = -1;
+    uint64_t start_ns = time_now_ns();
+    if(process_pool_start(&pool,command_line,working_directory,NULL)){
+        int slot = process_pool_wait(&pool,-1,&exit_code);
+        *duration_ns = time_now_ns() - start_ns;
+        if(slot >= 0){
+            *output = process_pool_remove(&pool,slot);
+        }else{
+            exit_code = -1;
+            process_pool_cancel(&pool);
+        }
+    }
+    process_pool_free(&pool);
+    return exit_code;
+}
+
+//runs one benchmark module warmup_runs times, then run_count times collecting what it reports
+static bool bench_run_module(const CbsBuild *build,const CbsModule *module,const char *executable_path,int warmup_runs,int run_count,CbsBenchResults *results){
+    char json_path[FILE_PATH_MAX];
+    if(path_format(json_path,"%s%s%c%s.json",build->mode_path,CBS_BENCH_DIRECTORY,FILE_SEPARATOR,module->name) == false){
+        return false;
+    }
+    make_directories_for_file(json_path);
+    CbsStringBuilder command = {0};
+    builder_append_quoted(&command,executable_path);
+    if(module->benchmark_format == CBS_BENCHMARK_GOOGLE){
+        builder_append_string(&command,"--benchmark_out_format=json --benchmark_out=");
+        builder_append_quoted(&command,json_path);
+    }
+
+    bool success = true;
+    for (int run = 0; run < warmup_runs + run_count && success && cbs_interrupted == false; run++) {
+        CbsStringBuilder output = {0};
+        uint64_t duration_ns = 0;
+        remove(json_path);
+        int exit_code = bench_run_once(command.items,build->program_path,&output,&duration_ns);
+        if(exit_code != 0){
+            if(cbs_interrupted == false) printf("  FAIL %s (exit code %d)\n",module->name,exit_code);
+            if(output.length > 0){
+                fwrite(output.items,1,output.length,stdout);
+                if(output.items[output.length - 1] != '\n') putchar('\n');
+            }
+            success = false;
+        }else if(run >= warmup_runs){
+            int parsed_count = module->benchmark_format == CBS_BENCHMARK_GOOGLE
+                ? bench_parse_google_json(json_path,results)
+                : bench_parse_lines(&output,results);
+            if(parsed_count == 0 && module->benchmark_format == CBS_BENCHMARK_GOOGLE){
+                cbs_log_error("no benchmarks found in [%s]",json_path);
+                success = false;
+            }else if(parsed_count == 0){
+                //a program that prints no bench lines is timed as a whole
+                bench_results_add(results,module->name,(double)duration_ns);
+            }
+        }
+        free(output.items);
+    }
+    free(command.items);
+    return success && cbs_interrupted == false;
+}
+
+//builds the modules, then runs the output of every module marked is_benchmark on its own, one after the other.
+//the median of each benchmark is compared against the baseline, and the run fails when one got slower by more
+//than the module's threshold. benchmarks without a baseline yet, or all of them with --update-baseline, are saved
+bool cbs_modules_bench(const CbsModule *module_array,const int array_length){
+    CbsBuild build;
+    if(build_init(&build,module_array,array_length,NULL) == false || build_execute(&build) == false){
+        build_free(&build);
+        return false;
+    }
+
+    int run_count = cbs_options.benchmark_runs > 0 ? cbs_options.benchmark_runs : CBS_BENCH_DEFAULT_RUNS;
+    int warmup_runs = cbs_options.warmup_runs_given ? cbs_options.benchmark_warmup_runs : CBS_BENCH_DEFAULT_WARMUP_RUNS;
+    if(warmup_runs < 0) warmup_runs = 0;
+    char baseline_path[FILE_PATH_MAX];
+    bool baseline_path_fits = cbs_options.baseline_path != NULL
+        ? path_format(baseline_path,"%s",cbs_options.baseline_path)
+        : path_format(baseline_path,"%s%s",build.mode_path,CBS_BENCH_BASELINE_FILENAME);
+    if(baseline_path_fits == false){
+        build_free(&build);
+        return false;
+    }
+
+    if(cbs_options.dry_run){
+        for (int i = 0; i < array_length; i++) {
+            if(module_array[i].is_benchmark == false) continue;
+            printf("[bench] %s (%d warm-up, %d run(s))\n",build.jobs[build.link_jobs[i]].output_path,warmup_runs,run_count);
+        }
+        build_free(&build);
+        return true;
+    }
+
+    if(cbs_options.pin_benchmarks){
+        if(pin_to_cpu(cbs_options.benchmark_cpu)){
+            printf("benchmarks are pinned to cpu %d\n",cbs_options.benchmark_cpu);
+        }else{
+            cbs_log_error("couldn't pin the benchmarks to cpu %d, they run unpinned",cbs_options.benchmark_cpu);
+        }
+    }
+
+    CbsMap baseline = {0};
+    bench_baseline_load(&baseline,baseline_path);
+    bool baseline_changed = false;
+    int benchmark_count = 0;
+    int failed_count = 0;
+    int regressed_count = 0;
+    for (int i = 0; i < array_length && cbs_interrupted == false; i++) {
+        const CbsModule *module = &module_array[i];
+        if(module->is_benchmark == false) continue;
+        printf("[bench] %s (%d warm-up, %d run(s))\n",module->name,warmup_runs,run_count);
+        fflush(stdout);
+        CbsBenchResults results = {0};
+        if(bench_run_module(&build,module,build.jobs[build.link_jobs[i]].output_path,warmup_runs,run_count,&results) == false){
+            failed_count++;
+            bench_results_free(&results);
+            continue;
+        }
+
+        double threshold_percent = module->benchmark_threshold_percent > 0 ? module->benchmark_threshold_percent : CBS_BENCH_DEFAULT_THRESHOLD_PERCENT;
+        for (int n = 0; n < results.names.length; n++) {
+            const char *name = results.names.items[n];
+            double median_ns = bench_median(map_get(&results.samples,name));
+            char key[FILE_PATH_MAX];
+            snprintf(key,FILE_PATH_MAX,"%s/%s",module->name,name);
+            char median_text[32];
+            bench_format_time(median_ns,median_text,sizeof(median_text));
+            benchmark_count++;
+
+            double *baseline_ns = map_get(&baseline,key);
+            if(baseline_ns == NULL || cbs_options.update_baseline){
+                printf("  %-40s %12s  %s\n",name,median_text,baseline_ns == NULL ? "new baseline" : "baseline updated");
+                if(baseline_ns == NULL){
+                    baseline_ns = malloc(sizeof(double));
+                    map_put(&baseline,key,baseline_ns);
+                }
+                *baseline_ns = median_ns;
+                baseline_changed = true;
+                continue;
+            }
+            char baseline_text[32];
+            bench_format_time(*baseline_ns,baseline_text,sizeof(baseline_text));
+            double change_percent = *baseline_ns > 0 ? (median_ns - *baseline_ns) * 100 / *baseline_ns : 0;
+            bool regressed = change_percent > threshold_percent;
+            if(regressed) regressed_count++;
+            printf("  %-40s %12s  baseline %s, %+.1f%%%s\n",name,median_text,baseline_text,change_percent,regressed ? "  REGRESSED" : "");
+        }
+        fflush(stdout);
+        bench_results_free(&results);
+    }
+    pin_to_cpu(-1);
+
+    if(cbs_interrupted) cbs_log_error("interrupted, the baseline is left alone");
+    else if(baseline_changed) bench_baseline_save(&baseline,baseline_path);
+    map_free(&baseline,true);
+
+    printf("%d benchmark(s), %d regressed, %d module(s) failed to run\n",benchmark_count,regressed_count,failed_count);
+    build_free(&build);
+    return regressed_count == 0 && failed_count == 0 && cbs_interrupted == false;
+}
+
+// ==========================================
+// ============ INSTALL =====================
+// ==========================================
+
+#define CBS_INSTALL_DIRECTORY "install"
+#define CBS_INSTALL_TEMPORARY_SUFFIX ".cbs-tmp"
+
+typedef struct CbsInstall{
+    int method_counts[CBS_COPY_FAILED];
+    int unchanged_count;
+    int failed_count;
+}CbsInstall;
+
+static bool files_have_same_content(const char *a,const char *b){
+    CbsMappedFile mapped_a;
+    CbsMappedFile mapped_b;
+    if(file_map(a,&mapped_a) == false) return false;
+    if(file_map(b,&mapped_b) == false){
+        file_unmap(&mapped_a);
+        return false;
+    }
+    bool same = mapped_a.size == mapped_b.size && (mapped_a.size == 0 || memcmp(mapped_a.data,mapped_b.data,mapped_a.size) == 0);
+    file_unmap(&mapped_a);
+    file_unmap(&mapped_b);
+    return same;
+}
+
+//a copy gets the time of its source, so an unchanged file is usually told by size and time alone.
+//only when the time differs is the content compared. copies are written next to the destination
+//and renamed over it, so nothing that has the old file open or hard linked sees a half written one
+static void install_file(CbsInstall *install,const char *prefix,const char *from,const char *to){
+    const char *display_path = string_starts_with(to,prefix) ? &to[strlen(prefix)] : to;
+    int64_t from_ns = 0;
+    if(try_get_file_modified_time(from,&from_ns) == false){
+        //a dry run doesn't build, so outputs may not be there yet
+        if(cbs_options.dry_run){
+            printf("[install] %s (dry run)\n",display_path);
+            install->method_counts[CBS_COPY_BYTES]++;
+            return;
+        }
+        cbs_log_error("[%s] doesn't exist, nothing to install",from);
+        install->failed_count++;
+        return;
+    }
+    int64_t to_ns = 0;
+    if(try_get_file_modified_time(to,&to_ns)){
+        bool same_size = get_file_size(from) == get_file_size(to);
+        if(files_are_same(from,to) || (same_size && to_ns == from_ns)){
+            install->unchanged_count++;
+            return;
+        }
+        if(same_size && files_have_same_content(from,to)){
+            set_file_modified_time(to,from_ns);
+            install->unchanged_count++;
+            return;
+        }
+    }
+
+    if(cbs_options.dry_run){
+        printf("[install] %s (dry run)\n",display_path);
+        install->method_counts[CBS_COPY_BYTES]++;
+        return;
+    }
+    char temporary_path[FILE_PATH_MAX];
+    if(path_format(temporary_path,"%s%s",to,CBS_INSTALL_TEMPORARY_SUFFIX) == false){
+        install->failed_count++;
+        return;
+    }
+    make_directories_for_file(temporary_path);
+    remove(temporary_path);
+    CbsCopyMethod method = copy_file_fast(from,temporary_path);
+    if(method == CBS_COPY_FAILED){
+        cbs_log_error("couldn't copy [%s] to [%s]",from,temporary_path);
+        install->failed_count++;
+        return;
+    }
+    if(method != CBS_COPY_HARDLINK) set_file_modified_time(temporary_path,from_ns);
+    remove(to);
+    if(rename(temporary_path,to) != 0){
+        cbs_log_error("couldn't replace [%s]",to);
+        remove(temporary_path);
+        install->failed_count++;
+        return;
+    }
+    install->method_counts[method]++;
+    printf("[install] %s\n",display_path);
+}
+
+//where a file goes in the prefix. one that doesn't fit fails the install rather than landing somewhere else
+static bool install_destination(CbsInstall *install,char *to,const char *prefix,const char *directory,const char *name){
+    if(path_format(to,"%s%s%s",prefix,directory,name)) return true;
+    install->failed_count++;
+    return false;
+}
+
+//a file keeps its name, a folder is installed with everything in it, keeping its subfolders
+static void install_paths(CbsInstall *install,const CbsBuild *build,const char *prefix,const CbsStringArray *paths,const char *directory){
+    char from[FILE_PATH_MAX];
+    char to[FILE_PATH_MAX];
+    for (int i = 0; i < paths->length; i++) {
+        build_step_path(build,paths->items[i],from);
+        if(directory_exists(from) == false){
+            if(install_destination(install,to,prefix,directory,path_filename(from))) install_file(install,prefix,from,to);
+            continue;
+        }
+        if(string_ends_with_char(from,FILE_SEPARATOR) == false && buffer_append_char(from,FILE_PATH_MAX,FILE_SEPARATOR) == false){
+            install->failed_count++;
+            continue;
+        }
+        CbsStringList files = {0};
+        collect_files_with_extension(from,"",&files);
+        qsort(files.items,files.length,sizeof(char*),compare_strings);
+        for (int f = 0; f < files.length; f++) {
+            if(install_destination(install,to,prefix,directory,&files.items[f][strlen(from)])){
+                install_file(install,prefix,files.items[f],to);
+            }
+        }
+        string_list_free(&files);
+    }
+}
+
+static bool is_library_output(const char *filename){
+    return string_ends_with_string(filename,".so") || strstr(filename,".so.") != NULL
+        || string_ends_with_string(filename,".a") || string_ends_with_string(filename,".lib")
+        || string_ends_with_string(filename,".dylib");
+}
+
+//builds the modules, then puts the output of every module, its .dwp, install_headers and install_files into
+//the prefix given with --prefix. tests and benchmarks are left out. files the prefix already has are skipped
+bool cbs_modules_install(const CbsModule *module_array,const int array_length){
+    CbsBuild build;
+    if(build_init(&build,module_array,array_length,NULL) == false || build_execute(&build) == false){
+        build_free(&build);
+        return false;
+    }
+
+    char prefix[FILE_PATH_MAX];
+    bool prefix_fits = cbs_options.install_prefix != NULL
+        ? path_format(prefix,"%s",cbs_options.install_prefix)
+        : path_format(prefix,"%s%s",build.program_path,CBS_INSTALL_DIRECTORY);
+    if(prefix_fits && string_ends_with_char(prefix,FILE_SEPARATOR) == false){
+        prefix_fits = buffer_append_char(prefix,FILE_PATH_MAX,FILE_SEPARATOR);
+    }
+    if(prefix_fits == false){
+        build_free(&build);
+        return false;
+    }
+
+    CbsInstall install = {0};
+    char directory[FILE_PATH_MAX];
+    char include_directory[16];
+    char to[FILE_PATH_MAX];
+    char package_path[FILE_PATH_MAX];
+    snprintf(include_directory,sizeof(include_directory),"include%c",FILE_SEPARATOR);
+    for (int i = 0; i < array_length && cbs_interrupted == false; i++) {
+        const CbsModule *module = &module_array[i];
+        if(module->is_test || module->is_benchmark) continue;
+        const char *output_path = build.jobs[build.link_jobs[i]].output_path;
+
+        //windows looks for dlls next to the executable, so those stay in bin
+        if(module->install_directory != NULL){
+            bool directory_fits = path_format(directory,"%s",module->install_directory);
+            if(directory_fits && directory[0] != '\0' && string_ends_with_char(directory,FILE_SEPARATOR) == false){
+                directory_fits = buffer_append_char(directory,FILE_PATH_MAX,FILE_SEPARATOR);
+            }
+            if(directory_fits == false){
+                install.failed_count++;
+                continue;
+            }
+        }else{
+            const char *folder = is_library_output(module->output_file_name_with_extension) ? "lib" : "bin";
+            snprintf(directory,FILE_PATH_MAX,"%s%c",folder,FILE_SEPARATOR);
+        }
+        if(install_destination(&install,to,prefix,directory,path_filename(output_path))){
+            install_file(&install,prefix,output_path,to);
+        }
+
+        if(module_splits_dwarf(module) && module->debug_info.package_dwp){
+            if(path_format(package_path,"%s.dwp",output_path) == false){
+                install.failed_count++;
+            }else if(install_destination(&install,to,prefix,directory,path_filename(package_path))){
+                install_file(&install,prefix,package_path,to);
+            }
+        }
+
+        install_paths(&install,&build,prefix,&module->install_headers,include_directory);
+        install_paths(&install,&build,prefix,&module->install_files,directory);
+    }
+
+    int installed_count = 0;
+    for (int m = 0; m < CBS_COPY_FAILED; m++) {
+        installed_count += install.method_counts[m];
+    }
+    if(cbs_options.dry_run){
+        printf("%d file(s) would be installed to %s, %d unchanged\n",installed_count,prefix,install.unchanged_count);
+    }else{
+        printf("%d file(s) installed to %s (%d cloned, %d copied by the kernel, %d hard linked, %d copied), %d unchanged\n",
+            installed_count,prefix,install.method_counts[CBS_COPY_CLONE],install.method_counts[CBS_COPY_KERNEL],
+            install.method_counts[CBS_COPY_HARDLINK],install.method_counts[CBS_COPY_BYTES],install.unchanged_count);
+    }
+    build_free(&build);
+    return install.failed_count == 0 && cbs_interrupted == false;
 }
 
 void cbs_command_run_matching(
@@ -69,7 +69,8 @@ void Copy_File(const char *from, const char *to){
     }
 }
 
-void Run_Cmd(char* cmd){
+//returns the exit code of the command, -1 if it couldn't be started
+int Run_Cmd(char* cmd){
     STARTUPINFO si = { 0 };
     PROCESS_INFORMATION pi = { 0 };   
 
@@ -90,52 +91,147 @@ void Run_Cmd(char* cmd){
     if (!success) {
         DWORD last_error =GetLastError();
         printf("CreateProcess failed (%d).\n", (int)last_error);
-        return;
+        return -1;
     }
 
-    WaitForSingleObject(pi.hProcess, 10000);
+    //builds and test runs take as long as they take
+    WaitForSingleObject(pi.hProcess, INFINITE);
 
-    DWORD exit_code;
+    DWORD exit_code = 1;
     GetExitCodeProcess(pi.hProcess, &exit_code);
-    if (exit_code != 0) {
-        fprintf(stderr,"Compiler exited with code %d", (int)exit_code);
-    }
 
     CloseHandle(pi.hProcess);
     CloseHandle(pi.hThread);
+    return (int)exit_code;
 }
 
 #elif defined(__linux__)
 #include<unistd.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<sys/ioctl.h>
+#include<sys/syscall.h>
+#include<sys/wait.h>
 #define FILE_PATH_MAX 4096
 #define FILE_SEPARATOR '/'
+#ifndef FICLONE
+#define FICLONE _IOW(0x94,9,int)
+#endif
 void Get_Current_Directory(char* path_buffer,size_t buffer_length){
-    //TODO Implement this function
+    if(getcwd(path_buffer,buffer_length) == NULL) path_buffer[0] = '\0';
 }
 void Get_Current_Exe_Path(char* path_buffer,size_t buffer_size){
-    //TODO Implement this function
+    path_buffer[0] = '\0';
+    ssize_t length = readlink("/proc/self/exe",path_buffer,buffer_size-1);
+    if(length <= 0) return;
+    path_buffer[length] = '\0';
+    for (ssize_t i = length-1; i >= 0; i--) {
+        if(path_buffer[i] == FILE_SEPARATOR){
+            path_buffer[i] = '\0';
+            return;
+        }
+    }
 }
+//shares the blocks when the filesystem can, then lets the kernel copy, then copies through a buffer.
+//no hard link, the copied templates get edited
 void Copy_File(const char *from, const char *to){
-    //TODO Implement this function
+    int from_fd = open(from,O_RDONLY);
+    if(from_fd == -1){
+        fprintf(stderr,"couldn't copy file from [%s] to [%s]. Errcode [%d]",from,to,errno);
+        return;
+    }
+    struct stat info;
+    mode_t mode = fstat(from_fd,&info) == 0 ? (info.st_mode & 0777) : 0644;
+    int to_fd = open(to,O_WRONLY | O_CREAT | O_EXCL,mode);
+    if(to_fd == -1){
+        fprintf(stderr,"couldn't copy file from [%s] to [%s]. Errcode [%d]",from,to,errno);
+        close(from_fd);
+        return;
+    }
+    bool copied = ioctl(to_fd,FICLONE,from_fd) == 0;
+#ifdef SYS_copy_file_range
+    while(copied == false){
+        ssize_t count = syscall(SYS_copy_file_range,from_fd,NULL,to_fd,NULL,(size_t)1 << 30,0);
+        if(count == 0) copied = true;
+        if(count <= 0) break;
+    }
+#endif
+    char buffer[65536];
+    while(copied == false){
+        ssize_t count = read(from_fd,buffer,sizeof(buffer));
+        if(count == 0) copied = true;
+        if(count <= 0 || write(to_fd,buffer,(size_t)count) != count) break;
+    }
+    close(from_fd);
+    if(close(to_fd) != 0) copied = false;
+    if(copied == false){
+        fprintf(stderr,"couldn't copy file from [%s] to [%s]. Errcode [%d]",from,to,errno);
+        remove(to);
+    }
 }
-void Run_Cmd(char* cmd){
-     //TODO Implement this function
+int Run_Cmd(char* cmd){
+    pid_t pid = fork();
+    if(pid == -1){
+        fprintf(stderr,"fork failed (%d).\n",errno);
+        return -1;
+    }
+    if(pid == 0){
+        execl("/bin/sh","sh","-c",cmd,(char*)NULL);
+        _exit(127);
+    }
+    int status = 0;
+    while(waitpid(pid,&status,0) == -1){
+        if(errno != EINTR) return -1;
+    }
+    if(WIFEXITED(status)) return WEXITSTATUS(status);
+    return 128 + WTERMSIG(status);
 }
 #elif defined(__APPLE__)
 #include<mach-o/dyld.h>
+#include<copyfile.h>
+#include<unistd.h>
+#include<errno.h>
+#include<sys/wait.h>
 #define FILE_PATH_MAX 1024
 #define FILE_SEPARATOR '/'
 void Get_Current_Directory(char* path_buffer,size_t buffer_length){
-    //TODO Implement this function
+    if(getcwd(path_buffer,buffer_length) == NULL) path_buffer[0] = '\0';
 }
 void Get_Current_Exe_Path(char* path_buffer,size_t buffer_size){
-    //TODO Implement this function
+    uint32_t size = (uint32_t)buffer_size;
+    if(_NSGetExecutablePath(path_buffer,&size) != 0){
+        path_buffer[0] = '\0';
+        return;
+    }
+    for (int i = (int)strlen(path_buffer)-1; i >= 0; i--) {
+        if(path_buffer[i] == FILE_SEPARATOR){
+            path_buffer[i] = '\0';
+            return;
+        }
+    }
 }
+//COPYFILE_CLONE shares the blocks on apfs and copies otherwise, COPYFILE_EXCL keeps an existing file
 void Copy_File(const char *from, const char *to){
-    //TODO Implement this function
+    if(copyfile(from,to,NULL,COPYFILE_ALL | COPYFILE_CLONE | COPYFILE_EXCL) != 0){
+        fprintf(stderr,"couldn't copy file from [%s] to [%s]. Errcode [%d]",from,to,errno);
+    }
 }
-void Run_Cmd(char* cmd){
-     //TODO Implement this function
+int Run_Cmd(char* cmd){
+    pid_t pid = fork();
+    if(pid == -1){
+        fprintf(stderr,"fork failed (%d).\n",errno);
+        return -1;
+    }
+    if(pid == 0){
+        execl("/bin/sh","sh","-c",cmd,(char*)NULL);
+        _exit(127);
+    }
+    int status = 0;
+    while(waitpid(pid,&status,0) == -1){
+        if(errno != EINTR) return -1;
+    }
+    if(WIFEXITED(status)) return WEXITSTATUS(status);
+    return 128 + WTERMSIG(status);
 }
 #endif
 
@@ -168,7 +264,7 @@ void init_file_paths(void){
     snprintf(file_paths.exe,FILE_PATH_MAX,"%s%c%s",file_paths.dir,FILE_SEPARATOR,TARGET_BUILD_EXE_FILENAME);
 }
 
-void command_compile(const char* compiler){
+int command_compile(const char* compiler){
 
     char cmd_buffer[CMD_BUFFER_SIZE];
     memset(cmd_buffer,0,8192);
@@ -183,7 +279,11 @@ void command_compile(const char* compiler){
     buffer_append_string(cmd_buffer,CMD_BUFFER_SIZE,file_paths.exe);
 
     debug(cmd_buffer);
-    Run_Cmd(cmd_buffer);
+    int exit_code = Run_Cmd(cmd_buffer);
+    if(exit_code != 0){
+        fprintf(stderr,"Compiler exited with code %d\n",exit_code);
+    }
+    return exit_code;
 }
 
 void command_init(void){
@@ -225,7 +325,8 @@ void command_help(void){
     fprintf(stdout,"%s",help_text);
 }
 
-void command_defer(int argc, char** argv){
+//returns the exit code of build.exe so scripts and CI see failed builds and tests
+int command_defer(int argc, char** argv){
 
     char cmd_buffer[CMD_BUFFER_SIZE];
     memset(cmd_buffer,0,8192);
@@ -236,7 +337,7 @@ void command_defer(int argc, char** argv){
         buffer_append_string(cmd_buffer,CMD_BUFFER_SIZE,argv[i]);
     }
 
-    Run_Cmd(cmd_buffer);
+    return Run_Cmd(cmd_buffer);
 }
 
 int main(int argc, char** argv){
@@ -263,7 +364,7 @@ int main(int argc, char** argv){
             fprintf(stderr,"header file: %s. Use the init command to recreate\n",TARGET_BUILD_H_FILENAME);
             return 1;
         }
-        command_compile(argv[2]);
+        if(command_compile(argv[2]) != 0) return 1;
     }else if(argc == 2 && strcmp(argv[1],"init")==0){
         debug("init");
         command_init();
@@ -271,7 +372,7 @@ int main(int argc, char** argv){
         command_help();
     }else if(file_exists(file_paths.exe)){
         debug("defer");
-        command_defer(argc,argv);
+        return command_defer(argc,argv);
     }else{
         debug("help2");
         command_help();